@@ -0,0 +1,272 @@
+#include "gophergdk.h"
+
+enum CHECK_STORAGE {IMAGE_STORAGE=0,NATIVE_STORAGE=1,INDEX_STORAGE=2};
+
+const unsigned long int CHECK_WIDTH=64;
+const unsigned long int CHECK_HEIGHT=48;
+const unsigned long int SPRITE_WIDTH=13;
+const unsigned long int SPRITE_HEIGHT=11;
+
+class Check_Frame:public GOPHERGDK::Frame
+{
+ public:
+ void create_frame(const bool indexed);
+ bool compare(Check_Frame &target);
+};
+
+void Check_Frame::create_frame(const bool indexed)
+{
+ this->set_size(CHECK_WIDTH,CHECK_HEIGHT);
+ if (indexed==true)
+ {
+  this->create_indexed_buffers();
+ }
+ else
+ {
+  this->create_buffers();
+ }
+
+}
+
+bool Check_Frame::compare(Check_Frame &target)
+{
+ bool result;
+ if (this->is_indexed()==true)
+ {
+  result=memcmp(this->get_indexes(),target.get_indexes(),this->get_pixels())==0;
+ }
+ else
+ {
+  result=memcmp(this->get_buffer(),target.get_buffer(),this->get_pixels()*sizeof(unsigned short int))==0;
+ }
+ return result;
+}
+
+unsigned char get_sprite_index(const unsigned long int x,const unsigned long int y)
+{
+ unsigned char index;
+ index=0;
+ if ((x%SPRITE_WIDTH>1)&&(y>0)&&((x+y)%5!=0)) index=1+(x*7+y*3)%200;
+ return index;
+}
+
+void get_palette_color(const unsigned char index,unsigned char *pixel)
+{
+ pixel[0]=(index*19)&255;
+ pixel[1]=(index*23+64)&255;
+ pixel[2]=(index*index*7+128)&255;
+}
+
+void create_sprite_image(const char *name,const bool indexed)
+{
+ FILE *target;
+ unsigned char head[18];
+ unsigned char pixel[3];
+ unsigned long int x,y;
+ unsigned short int index;
+ target=fopen(name,"wb");
+ if (target==NULL)
+ {
+  puts("Can't create the test image");
+  exit(EXIT_FAILURE);
+ }
+ memset(head,0,sizeof(head));
+ head[2]=2;
+ head[12]=(SPRITE_WIDTH*2)&255;
+ head[13]=(SPRITE_WIDTH*2) >> 8;
+ head[14]=SPRITE_HEIGHT&255;
+ head[15]=SPRITE_HEIGHT >> 8;
+ head[16]=24;
+ if (indexed==true)
+ {
+  head[1]=1;
+  head[2]=1;
+  head[6]=1;
+  head[7]=24;
+  head[16]=8;
+ }
+ fwrite(head,sizeof(head),1,target);
+ if (indexed==true)
+ {
+  for (index=0;index<256;++index)
+  {
+   get_palette_color(index,pixel);
+   fwrite(pixel,sizeof(pixel),1,target);
+  }
+
+ }
+ for (y=0;y<SPRITE_HEIGHT;++y)
+ {
+  for (x=0;x<SPRITE_WIDTH*2;++x)
+  {
+   if (indexed==true)
+   {
+    pixel[0]=get_sprite_index(x,y);
+    fwrite(pixel,1,1,target);
+   }
+   else
+   {
+    get_palette_color(get_sprite_index(x,y),pixel);
+    fwrite(pixel,sizeof(pixel),1,target);
+   }
+
+  }
+
+ }
+ fclose(target);
+}
+
+void load_sprite(GOPHERGDK::Sprite &sprite,const CHECK_STORAGE storage)
+{
+ GOPHERGDK::Image image;
+ switch (storage)
+ {
+  case IMAGE_STORAGE:
+  image.load_tga("blit_check.tga");
+  sprite.load_sprite(image,HORIZONTAL_STRIP,2);
+  break;
+  case NATIVE_STORAGE:
+  sprite.load_tga("blit_check.tga");
+  sprite.set_frames(2);
+  sprite.set_kind(HORIZONTAL_STRIP);
+  break;
+  case INDEX_STORAGE:
+  image.load_tga("blit_check_indexed.tga");
+  sprite.load_sprite(image,HORIZONTAL_STRIP,2);
+  break;
+ }
+
+}
+
+bool check_transparent(GOPHERGDK::Sprite &sprite,const size_t offset)
+{
+ bool result;
+ if (sprite.is_indexed()==true)
+ {
+  result=sprite.get_indexes()[offset]==sprite.get_indexes()[0];
+ }
+ else if (sprite.is_native()==true)
+ {
+  result=sprite.get_pixels()[offset]==sprite.get_pixels()[0];
+ }
+ else
+ {
+  result=(sprite.get_image()[offset].red==sprite.get_image()[0].red)&&(sprite.get_image()[offset].green==sprite.get_image()[0].green)&&(sprite.get_image()[offset].blue==sprite.get_image()[0].blue);
+ }
+ return result;
+}
+
+void draw_reference_pixel(Check_Frame &target,GOPHERGDK::Sprite &sprite,const size_t offset,const unsigned long int x,const unsigned long int y)
+{
+ IMG_Pixel pixel;
+ if (sprite.is_indexed()==true)
+ {
+  if (target.is_indexed()==true)
+  {
+   target.draw_index(x,y,sprite.get_indexes()[offset]);
+  }
+  else
+  {
+   target.draw_native_pixel(x,y,sprite.get_palette()[sprite.get_indexes()[offset]]);
+  }
+
+ }
+ else if (sprite.is_native()==true)
+ {
+  target.draw_native_pixel(x,y,sprite.get_pixels()[offset]);
+ }
+ else
+ {
+  pixel=sprite.get_image()[offset];
+  target.draw_pixel(x,y,pixel.red,pixel.green,pixel.blue);
+ }
+
+}
+
+void draw_reference(Check_Frame &target,GOPHERGDK::Sprite &sprite,const unsigned long int frame,const unsigned long int sprite_x,const unsigned long int sprite_y)
+{
+ unsigned long int x,y,target_x,target_y,width,height;
+ size_t start,offset;
+ width=sprite.get_width();
+ height=sprite.get_height();
+ start=static_cast<size_t>(frame-1)*width;
+ for (y=0;y<height;++y)
+ {
+  for (x=0;x<width;++x)
+  {
+   offset=start+x+static_cast<size_t>(y)*sprite.get_image_width();
+   if ((sprite.get_transparent()==true)&&(check_transparent(sprite,offset)==true)) continue;
+   target_x=x;
+   target_y=y;
+   if (sprite.get_horizontal_flip()==true) target_x=width-1-x;
+   if (sprite.get_vertical_flip()==true) target_y=height-1-y;
+   if ((sprite_x>=CHECK_WIDTH)||(target_x>=CHECK_WIDTH-sprite_x)) continue;
+   if ((sprite_y>=CHECK_HEIGHT)||(target_y>=CHECK_HEIGHT-sprite_y)) continue;
+   draw_reference_pixel(target,sprite,offset,sprite_x+target_x,sprite_y+target_y);
+  }
+
+ }
+
+}
+
+unsigned long int check_blits(const CHECK_STORAGE storage,const bool indexed,unsigned long int &total)
+{
+ const char *names[3]={"image","native","indexed"};
+ Check_Frame screen;
+ Check_Frame reference;
+ GOPHERGDK::Sprite sprite;
+ unsigned long int positions[8][2]={{0,0},{20,17},{CHECK_WIDTH-SPRITE_WIDTH,CHECK_HEIGHT-SPRITE_HEIGHT},{CHECK_WIDTH-5,3},{7,CHECK_HEIGHT-4},{CHECK_WIDTH-2,CHECK_HEIGHT-2},{CHECK_WIDTH,0},{ULONG_MAX-3,ULONG_MAX-3}};
+ unsigned long int frame,position,failed;
+ unsigned short int mode;
+ screen.create_frame(indexed);
+ reference.create_frame(indexed);
+ sprite.initialize(&screen);
+ load_sprite(sprite,storage);
+ failed=0;
+ for (mode=0;mode<8;++mode)
+ {
+  sprite.set_transparent((mode&1)!=0);
+  sprite.set_flip((mode&2)!=0,(mode&4)!=0);
+  for (frame=1;frame<=2;++frame)
+  {
+   sprite.set_target(frame);
+   for (position=0;position<8;++position)
+   {
+    screen.clear_screen();
+    reference.clear_screen();
+    sprite.draw_sprite(positions[position][0],positions[position][1]);
+    draw_reference(reference,sprite,frame,positions[position][0],positions[position][1]);
+    ++total;
+    if (screen.compare(reference)==false)
+    {
+     printf("Mismatch: %s sprite, indexed frame %d, transparent %d, horizontal flip %d, vertical flip %d, frame %lu, position %lu,%lu\n",names[storage],indexed,mode&1,(mode >> 1)&1,(mode >> 2)&1,frame,positions[position][0],positions[position][1]);
+     ++failed;
+    }
+
+   }
+
+  }
+
+ }
+ return failed;
+}
+
+int main()
+{
+ unsigned long int total,failed;
+ unsigned short int storage;
+ total=0;
+ failed=0;
+ create_sprite_image("blit_check.tga",false);
+ create_sprite_image("blit_check_indexed.tga",true);
+ for (storage=IMAGE_STORAGE;storage<=INDEX_STORAGE;++storage)
+ {
+  failed+=check_blits(static_cast<CHECK_STORAGE>(storage),false,total);
+  failed+=check_blits(static_cast<CHECK_STORAGE>(storage),true,total);
+ }
+ remove("blit_check.tga");
+ remove("blit_check_indexed.tga");
+ printf("%lu of %lu blits match the reference\n",total-failed,total);
+ if (failed>0) return 1;
+ return 0;
+}
\ No newline at end of file
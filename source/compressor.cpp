@@ -0,0 +1,64 @@
+#include "gophergdk.h"
+
+const unsigned long int BENCHMARK_PASSES=10;
+const size_t BENCHMARK_CHUNK=4096;
+
+unsigned long int get_microseconds()
+{
+ timeval current;
+ gettimeofday(&current,NULL);
+ return static_cast<unsigned long int>(current.tv_sec)*1000000+static_cast<unsigned long int>(current.tv_usec);
+}
+
+void benchmark_file(const char *name)
+{
+ GOPHERGDK::Input_File source;
+ unsigned char buffer[BENCHMARK_CHUNK];
+ unsigned long int pass,start,elapsed;
+ size_t length,piece,left;
+ bool compressed;
+ length=0;
+ compressed=false;
+ start=get_microseconds();
+ for (pass=0;pass<BENCHMARK_PASSES;++pass)
+ {
+  source.open(name);
+  compressed=source.is_compressed();
+  length=source.get_length();
+  for (left=length;left>0;left-=piece)
+  {
+   piece=BENCHMARK_CHUNK;
+   if (piece>left) piece=left;
+   source.read(buffer,piece);
+  }
+  source.close();
+ }
+ elapsed=get_microseconds()-start;
+ if (elapsed==0) elapsed=1;
+ printf("%s: %lu bytes, %s, %lu microseconds per read, %.2f MB/s\n",name,static_cast<unsigned long int>(length),compressed==true ? "compressed":"raw",elapsed/BENCHMARK_PASSES,(static_cast<double>(length)*BENCHMARK_PASSES)/static_cast<double>(elapsed));
+}
+
+int main(int argc,char *argv[])
+{
+ GOPHERGDK::LZ_Compressor compressor;
+ GOPHERGDK::Input_File source;
+ GOPHERGDK::Input_File target;
+ if ((argc==4)&&(strcmp(argv[1],"-b")==0))
+ {
+  benchmark_file(argv[2]);
+  benchmark_file(argv[3]);
+  return 0;
+ }
+ if (argc!=3)
+ {
+  puts("Usage: compressor <source file> <target file>");
+  puts("Benchmark: compressor -b <raw file> <compressed file>");
+  return 0;
+ }
+ compressor.compress_file(argv[1],argv[2]);
+ source.open(argv[1]);
+ target.open(argv[2]);
+ printf("%s: %ld bytes\n",argv[1],source.get_length());
+ printf("%s: %ld bytes\n",argv[2],target.Binary_File::get_length());
+ return 0;
+}
\ No newline at end of file
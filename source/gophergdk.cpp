@@ -21,10 +21,28 @@ SVGALib homepage: http://www.svgalib.org
 
 #include "gophergdk.h"
 
+#if defined(__GNUC__) && !defined(GOPHERGDK_NO_VECTOR)
+#if defined(__SSE2__) || defined(__ARM_NEON) || defined(__mips_msa)
+#define GOPHERGDK_VECTOR
+#endif
+#endif
+
 const int SOUND_CHANNELS=1;
 const unsigned char GAMEPAD_PRESS=1;
 const unsigned char GAMEPAD_RELEASE=0;
 const size_t BUTTON_AMOUNT=14;
+const int FIXED_SHIFT=16;
+const long int FIXED_ONE=65536;
+const unsigned long int PIXEL_MASK=0x07E0F81F;
+const unsigned long int ALPHA_LIMIT=32;
+const unsigned long int BAND_LINES=16;
+const unsigned long int DYNAMIC_LEVELS=8;
+const unsigned long int DYNAMIC_SAMPLES=8;
+
+#ifdef GOPHERGDK_VECTOR
+typedef unsigned short int Pixel_Block __attribute__ ((vector_size(16)));
+const size_t BLOCK_PIXELS=sizeof(Pixel_Block)/sizeof(unsigned short int);
+#endif
 
 namespace OSS_BACKEND
 {
@@ -53,6 +71,18 @@ void* oss_play_sound(void *buffer)
  return NULL;
 }
 
+void* stream_world_chunks(void *target)
+{
+ static_cast<Streamed_Background*>(target)->load_chunks();
+ return NULL;
+}
+
+void* load_assets(void *target)
+{
+ static_cast<Async_Loader*>(target)->load_jobs();
+ return NULL;
+}
+
 void Halt(const char *message)
 {
  puts(message);
@@ -67,6 +97,15 @@ Frame::Frame()
  length=0;
  buffer=NULL;
  shadow=NULL;
+ indexes=NULL;
+ index_shadow=NULL;
+ inverse=NULL;
+ indexed=false;
+ inverse_changed=true;
+ effect_used=false;
+ revision=0;
+ crossfade_alpha=ALPHA_LIMIT;
+ this->set_default_palette();
 }
 
 Frame::~Frame()
@@ -81,6 +120,21 @@ Frame::~Frame()
   delete[] shadow;
   shadow=NULL;
  }
+ if (indexes!=NULL)
+ {
+  delete[] indexes;
+  indexes=NULL;
+ }
+ if (index_shadow!=NULL)
+ {
+  delete[] index_shadow;
+  index_shadow=NULL;
+ }
+ if (inverse!=NULL)
+ {
+  delete[] inverse;
+  inverse=NULL;
+ }
 
 }
 
@@ -115,6 +169,225 @@ void Frame::clear_buffer(unsigned short int *target)
 
 }
 
+unsigned char *Frame::create_index_buffer(const char *error)
+{
+ unsigned char *target;
+ target=NULL;
+ try
+ {
+  target=new unsigned char[pixels];
+ }
+ catch (...)
+ {
+  Halt(error);
+ }
+ memset(target,0,pixels);
+ return target;
+}
+
+void Frame::set_default_palette()
+{
+ unsigned short int index;
+ for (index=0;index<256;++index)
+ {
+  colors[index].red=((index >> 5)*255)/7;
+  colors[index].green=(((index >> 2)&7)*255)/7;
+  colors[index].blue=((index&3)*255)/3;
+  palette[index]=this->pack_pixel(colors[index].red,colors[index].green,colors[index].blue);
+ }
+
+}
+
+long int Frame::get_distance(const long int red,const long int green,const long int blue,const unsigned short int index) const
+{
+ long int red_delta,green_delta,blue_delta;
+ red_delta=static_cast<long int>(colors[index].red)-red;
+ green_delta=static_cast<long int>(colors[index].green)-green;
+ blue_delta=static_cast<long int>(colors[index].blue)-blue;
+ return red_delta*red_delta+green_delta*green_delta+blue_delta*blue_delta;
+}
+
+void Frame::find_nearest(const size_t color)
+{
+ unsigned short int index;
+ long int red,green,blue,distance,best;
+ red=static_cast<long int>((color >> 8)*17); // 17 is 255/15
+ green=static_cast<long int>(((color >> 4)&15)*17);
+ blue=static_cast<long int>((color&15)*17);
+ best=LONG_MAX;
+ for (index=0;index<256;++index)
+ {
+  distance=this->get_distance(red,green,blue,index);
+  if (distance<best)
+  {
+   best=distance;
+   inverse[color]=index;
+  }
+
+ }
+
+}
+
+void Frame::build_inverse()
+{
+ size_t color;
+ if (inverse==NULL)
+ {
+  try
+  {
+   inverse=new unsigned char[4096];
+  }
+  catch (...)
+  {
+   Halt("Can't allocate memory for inverse palette");
+  }
+
+ }
+ for (color=0;color<4096;++color)
+ {
+  this->find_nearest(color);
+ }
+ inverse_changed=false;
+}
+
+void Frame::update_inverse(const unsigned char index)
+{
+ size_t color;
+ long int red,green,blue,distance,best;
+ for (color=0;color<4096;++color)
+ {
+  if (inverse[color]==index)
+  {
+   this->find_nearest(color);
+  }
+  else
+  {
+   red=static_cast<long int>((color >> 8)*17);
+   green=static_cast<long int>(((color >> 4)&15)*17);
+   blue=static_cast<long int>((color&15)*17);
+   distance=this->get_distance(red,green,blue,index);
+   best=this->get_distance(red,green,blue,inverse[color]);
+   if ((distance<best)||((distance==best)&&(index<inverse[color]))) inverse[color]=index;
+  }
+
+ }
+
+}
+
+void Frame::rotate_inverse(const unsigned char first,const unsigned char last)
+{
+ size_t color;
+ for (color=0;color<4096;++color)
+ {
+  if ((inverse[color]>=first)&&(inverse[color]<=last))
+  {
+   if (inverse[color]==last)
+   {
+    inverse[color]=first;
+   }
+   else
+   {
+    ++inverse[color];
+   }
+
+  }
+
+ }
+
+}
+
+unsigned long int Frame::get_alpha(const unsigned char level) const
+{
+ return (static_cast<unsigned long int>(level)*ALPHA_LIMIT+127)/UCHAR_MAX;
+}
+
+unsigned long int Frame::expand_pixel(const unsigned short int pixel) const
+{
+ return (static_cast<unsigned long int>(pixel)|(static_cast<unsigned long int>(pixel) << 16))&PIXEL_MASK;
+}
+
+unsigned short int Frame::compact_pixel(const unsigned long int pixel) const
+{
+ return static_cast<unsigned short int>((pixel|(pixel >> 16))&0xFFFF);
+}
+
+unsigned short int *Frame::get_effect_palette()
+{
+ if (effect_used==false)
+ {
+  memcpy(effect_palette,palette,sizeof(palette));
+  effect_used=true;
+ }
+ return effect_palette;
+}
+
+void Frame::mix_color(unsigned short int *target,const size_t amount,const unsigned short int color,const unsigned long int alpha)
+{
+ size_t index;
+ unsigned long int other;
+ index=0;
+ ++revision;
+#ifdef GOPHERGDK_VECTOR
+ Pixel_Block block,red,green,blue,level,red_color,green_color,blue_color;
+ for (index=0;index<BLOCK_PIXELS;++index)
+ {
+  level[index]=alpha;
+  red_color[index]=(color >> 11)*(ALPHA_LIMIT-alpha);
+  green_color[index]=((color >> 5)&63)*(ALPHA_LIMIT-alpha);
+  blue_color[index]=(color&31)*(ALPHA_LIMIT-alpha);
+ }
+ for (index=0;index+BLOCK_PIXELS<=amount;index+=BLOCK_PIXELS)
+ {
+  memcpy(&block,target+index,sizeof(Pixel_Block));
+  red=((block >> 11)*level+red_color) >> 5;
+  green=(((block >> 5)&63)*level+green_color) >> 5;
+  blue=((block&31)*level+blue_color) >> 5;
+  block=(red << 11)|(green << 5)|blue;
+  memcpy(target+index,&block,sizeof(Pixel_Block));
+ }
+#endif
+ other=this->expand_pixel(color)*(ALPHA_LIMIT-alpha);
+ for (;index<amount;++index)
+ {
+  target[index]=this->compact_pixel(((this->expand_pixel(target[index])*alpha+other) >> 5)&PIXEL_MASK);
+ }
+
+}
+
+void Frame::mix_shadow(const unsigned long int alpha)
+{
+ size_t index;
+ if (shadow!=NULL)
+ {
+  index=0;
+  ++revision;
+#ifdef GOPHERGDK_VECTOR
+  Pixel_Block block,other,red,green,blue,level,inverse;
+  for (index=0;index<BLOCK_PIXELS;++index)
+  {
+   level[index]=alpha;
+   inverse[index]=ALPHA_LIMIT-alpha;
+  }
+  for (index=0;index+BLOCK_PIXELS<=pixels;index+=BLOCK_PIXELS)
+  {
+   memcpy(&block,buffer+index,sizeof(Pixel_Block));
+   memcpy(&other,shadow+index,sizeof(Pixel_Block));
+   red=((block >> 11)*level+(other >> 11)*inverse) >> 5;
+   green=(((block >> 5)&63)*level+((other >> 5)&63)*inverse) >> 5;
+   blue=((block&31)*level+(other&31)*inverse) >> 5;
+   block=(red << 11)|(green << 5)|blue;
+   memcpy(buffer+index,&block,sizeof(Pixel_Block));
+  }
+#endif
+  for (;index<pixels;++index)
+  {
+   buffer[index]=this->compact_pixel(((this->expand_pixel(buffer[index])*alpha+this->expand_pixel(shadow[index])*(ALPHA_LIMIT-alpha)) >> 5)&PIXEL_MASK);
+  }
+
+ }
+
+}
+
 unsigned short int *Frame::create_buffer(const char *error)
 {
  unsigned short int *target;
@@ -147,6 +420,55 @@ void Frame::create_buffers()
  shadow=this->create_buffer("Can't allocate memory for shadow buffer");
 }
 
+void Frame::create_indexed_buffers()
+{
+ this->calculate_buffer_length();
+ indexes=this->create_index_buffer("Can't allocate memory for index buffer");
+ index_shadow=this->create_index_buffer("Can't allocate memory for shadow index buffer");
+ indexed=true;
+}
+
+void Frame::expand_indexes(unsigned short int *target,const size_t offset,const size_t amount)
+{
+ size_t index;
+ const unsigned short int *source;
+ const unsigned char *current;
+ const unsigned char *previous;
+ source=palette;
+ if (effect_used==true) source=effect_palette;
+ current=indexes+offset;
+ previous=index_shadow+offset;
+ if (crossfade_alpha<ALPHA_LIMIT)
+ {
+  for (index=0;index<amount;++index)
+  {
+   target[index]=this->compact_pixel(((this->expand_pixel(source[current[index]])*crossfade_alpha+this->expand_pixel(palette[previous[index]])*(ALPHA_LIMIT-crossfade_alpha)) >> 5)&PIXEL_MASK);
+  }
+
+ }
+ else
+ {
+  for (index=0;index<amount;++index)
+  {
+   target[index]=source[current[index]];
+  }
+
+ }
+
+}
+
+void Frame::reset_effects()
+{
+ if ((effect_used==true)||(crossfade_alpha<ALPHA_LIMIT)) ++revision;
+ effect_used=false;
+ crossfade_alpha=ALPHA_LIMIT;
+}
+
+unsigned short int *Frame::get_render_buffer()
+{
+ return buffer;
+}
+
 size_t Frame::get_length() const
 {
  return length;
@@ -154,6 +476,7 @@ size_t Frame::get_length() const
 
 unsigned short int *Frame::get_buffer()
 {
+ ++revision;
  return buffer;
 }
 
@@ -172,6 +495,11 @@ unsigned long int Frame::get_frame_height() const
  return frame_height;
 }
 
+unsigned short int Frame::pack_pixel(const unsigned short int red,const unsigned short int green,const unsigned short int blue) const
+{
+ return (blue >> 3) +((green >> 2) << 5)+((red >> 3) << 11); // This code bases on code from SVGALib
+}
+
 bool Frame::draw_pixel(const unsigned long int x,const unsigned long int y,const unsigned short int red,const unsigned short int green,const unsigned short int blue)
 {
  bool result;
@@ -180,23 +508,139 @@ bool Frame::draw_pixel(const unsigned long int x,const unsigned long int y,const
  offset=static_cast<size_t>(x)+static_cast<size_t>(y)*static_cast<size_t>(frame_width);
  if (offset<pixels)
  {
-  buffer[offset]=(blue >> 3) +((green >> 2) << 5)+((red >> 3) << 11); // This code bases on code from SVGALib
+  if (indexed==true)
+  {
+   indexes[offset]=this->find_index(red,green,blue);
+  }
+  else
+  {
+   buffer[offset]=this->pack_pixel(red,green,blue);
+  }
+  ++revision;
+  result=true;
+ }
+ return result;
+}
+
+bool Frame::draw_native_pixel(const unsigned long int x,const unsigned long int y,const unsigned short int color)
+{
+ bool result;
+ size_t offset;
+ result=false;
+ offset=static_cast<size_t>(x)+static_cast<size_t>(y)*static_cast<size_t>(frame_width);
+ if (offset<pixels)
+ {
+  if (indexed==true)
+  {
+   indexes[offset]=this->find_index((color >> 11) << 3,((color >> 5)&63) << 2,(color&31) << 3);
+  }
+  else
+  {
+   buffer[offset]=color;
+  }
+  ++revision;
+  result=true;
+ }
+ return result;
+}
+
+bool Frame::is_indexed() const
+{
+ return indexed;
+}
+
+unsigned char *Frame::get_indexes()
+{
+ ++revision;
+ return indexes;
+}
+
+unsigned short int *Frame::get_palette()
+{
+ ++revision;
+ return palette;
+}
+
+bool Frame::draw_index(const unsigned long int x,const unsigned long int y,const unsigned char index)
+{
+ bool result;
+ size_t offset;
+ result=false;
+ offset=static_cast<size_t>(x)+static_cast<size_t>(y)*static_cast<size_t>(frame_width);
+ if ((indexed==true)&&(offset<pixels))
+ {
+  indexes[offset]=index;
+  ++revision;
   result=true;
  }
  return result;
 }
 
+unsigned char Frame::find_index(const unsigned char red,const unsigned char green,const unsigned char blue)
+{
+ if (inverse_changed==true) this->build_inverse();
+ return inverse[((red >> 4) << 8)|((green >> 4) << 4)|(blue >> 4)];
+}
+
+void Frame::set_palette_color(const unsigned char index,const unsigned char red,const unsigned char green,const unsigned char blue)
+{
+ colors[index].red=red;
+ colors[index].green=green;
+ colors[index].blue=blue;
+ palette[index]=this->pack_pixel(red,green,blue);
+ if (inverse_changed==false) this->update_inverse(index);
+ ++revision;
+}
+
+void Frame::rotate_palette(const unsigned char first,const unsigned char last)
+{
+ unsigned short int index,color;
+ IMG_Pixel original;
+ if (first<last)
+ {
+  color=palette[last];
+  original=colors[last];
+  for (index=last;index>first;--index)
+  {
+   palette[index]=palette[index-1];
+   colors[index]=colors[index-1];
+  }
+  palette[first]=color;
+  colors[first]=original;
+  if (inverse_changed==false) this->rotate_inverse(first,last);
+  ++revision;
+ }
+
+}
+
 void Frame::clear_screen()
 {
- this->clear_buffer(buffer);
+ ++revision;
+ if (indexed==true)
+ {
+  memset(indexes,0,pixels);
+ }
+ else
+ {
+  this->clear_buffer(buffer);
+ }
+
 }
 
 void Frame::save()
 {
  size_t index;
- for (index=0;index<pixels;++index)
+ if (indexed==true)
+ {
+  memcpy(index_shadow,indexes,pixels);
+ }
+ else
  {
-  shadow[index]=buffer[index];
+  for (index=0;index<pixels;++index)
+  {
+   shadow[index]=buffer[index];
+  }
+
  }
 
 }
@@ -204,31 +648,44 @@ void Frame::save()
 void Frame::restore()
 {
  size_t index;
- for (index=0;index<pixels;++index)
+ ++revision;
+ if (indexed==true)
+ {
+  memcpy(indexes,index_shadow,pixels);
+ }
+ else
  {
-  buffer[index]=shadow[index];
+  for (index=0;index<pixels;++index)
+  {
+   buffer[index]=shadow[index];
+  }
+
  }
 
 }
 
 void Frame::restore(const unsigned long int x,const unsigned long int y,const unsigned long int width,const unsigned long int height)
 {
- unsigned long int target_x,target_y,stop_x,stop_y;
+ unsigned long int target_y,stop_x,stop_y;
  size_t position;
- stop_x=x+width;
- stop_y=y+height;
  if ((x<frame_width)&&(y<frame_height))
  {
-  if ((stop_x<=frame_width)&&(stop_y<=frame_height))
+  stop_x=frame_width-x;
+  stop_y=frame_height-y;
+  if (width<stop_x) stop_x=width;
+  if (height<stop_y) stop_y=height;
+  stop_y+=y;
+  ++revision;
+  for (target_y=y;target_y<stop_y;++target_y)
   {
-   for (target_x=x;target_x<stop_x;++target_x)
+   position=this->get_offset(x,target_y);
+   if (indexed==true)
    {
-    for (target_y=y;target_y<stop_y;++target_y)
-    {
-     position=this->get_offset(target_x,target_y);
-     buffer[position]=shadow[position];
-    }
-
+    memcpy(indexes+position,index_shadow+position,stop_x);
+   }
+   else
+   {
+    memcpy(buffer+position,shadow+position,static_cast<size_t>(stop_x)*sizeof(unsigned short int));
    }
 
   }
@@ -237,21 +694,79 @@ void Frame::restore(const unsigned long int x,const unsigned long int y,const un
 
 }
 
-Plane::Plane()
-{
- target=NULL;
- plane=NULL;
- target_width=0;
- target_height=0;
- x_ratio=0;
- y_ratio=0;
-}
-
-Plane::~Plane()
+void Frame::fade(const unsigned char red,const unsigned char green,const unsigned char blue,const unsigned char level)
 {
+ if (indexed==true)
+ {
+  this->mix_color(this->get_effect_palette(),256,this->pack_pixel(red,green,blue),ALPHA_LIMIT-this->get_alpha(level));
+ }
+ else
+ {
+  this->mix_color(buffer,pixels,this->pack_pixel(red,green,blue),ALPHA_LIMIT-this->get_alpha(level));
+ }
 
 }
 
+void Frame::scale_brightness(const unsigned char level)
+{
+ if (indexed==true)
+ {
+  this->mix_color(this->get_effect_palette(),256,0,this->get_alpha(level));
+ }
+ else
+ {
+  this->mix_color(buffer,pixels,0,this->get_alpha(level));
+ }
+
+}
+
+void Frame::crossfade(const unsigned char level)
+{
+ if (indexed==true)
+ {
+  crossfade_alpha=(crossfade_alpha*(ALPHA_LIMIT-this->get_alpha(level)))/ALPHA_LIMIT;
+  ++revision;
+ }
+ else
+ {
+  this->mix_shadow(ALPHA_LIMIT-this->get_alpha(level));
+ }
+
+}
+
+unsigned long int Frame::get_revision() const
+{
+ return revision;
+}
+
+void Frame::mark_changed()
+{
+ ++revision;
+}
+
+Plane::Plane()
+{
+ target=NULL;
+ plane=NULL;
+ target_width=0;
+ target_height=0;
+ x_ratio=0;
+ y_ratio=0;
+}
+
+Plane::~Plane()
+{
+
+}
+
+void Plane::set_plane_size(const unsigned long int width,const unsigned long int height)
+{
+ this->set_size(width,height);
+ this->calculate_buffer_length();
+ x_ratio=static_cast<float>(width)/static_cast<float>(target_width);
+ y_ratio=static_cast<float>(height)/static_cast<float>(target_height);
+}
+
 void Plane::create_plane(const unsigned long int width,const unsigned long int height,const unsigned long int surface_width,const unsigned long int surface_height,unsigned short int *surface_buffer)
 {
  this->set_size(width,height);
@@ -293,6 +808,269 @@ Plane* Plane::get_handle()
  return this;
 }
 
+Dynamic_Plane::Dynamic_Plane()
+{
+ maximum_width=0;
+ maximum_height=0;
+ minimum_width=0;
+ minimum_height=0;
+ level=DYNAMIC_LEVELS;
+ budget=0;
+ total=0;
+ frames=0;
+ gettimeofday(&previous,NULL);
+}
+
+Dynamic_Plane::~Dynamic_Plane()
+{
+
+}
+
+unsigned long int Dynamic_Plane::get_elapsed()
+{
+ timeval current;
+ unsigned long int elapsed;
+ gettimeofday(&current,NULL);
+ elapsed=(current.tv_sec-previous.tv_sec)*1000000+(current.tv_usec-previous.tv_usec);
+ previous=current;
+ return elapsed;
+}
+
+void Dynamic_Plane::apply_level()
+{
+ unsigned long int width,height;
+ width=minimum_width+((maximum_width-minimum_width)*level)/DYNAMIC_LEVELS;
+ height=minimum_height+((maximum_height-minimum_height)*level)/DYNAMIC_LEVELS;
+ this->set_plane_size(width,height);
+}
+
+void Dynamic_Plane::check_frame_time(const unsigned long int elapsed)
+{
+ unsigned long int average;
+ total+=elapsed;
+ ++frames;
+ if (frames==DYNAMIC_SAMPLES)
+ {
+  average=total/frames;
+  total=0;
+  frames=0;
+  if ((average>budget+budget/20)&&(level>0))
+  {
+   --level;
+   this->apply_level();
+  }
+  if ((average<budget-budget/5)&&(level<DYNAMIC_LEVELS))
+  {
+   ++level;
+   this->apply_level();
+  }
+
+ }
+
+}
+
+void Dynamic_Plane::create_dynamic_plane(const unsigned long int width,const unsigned long int height,const unsigned long int surface_width,const unsigned long int surface_height,unsigned short int *surface_buffer)
+{
+ this->create_plane(width,height,surface_width,surface_height,surface_buffer);
+ maximum_width=width;
+ maximum_height=height;
+ minimum_width=width/2;
+ minimum_height=height/2;
+ level=DYNAMIC_LEVELS;
+ total=0;
+ frames=0;
+ gettimeofday(&previous,NULL);
+}
+
+void Dynamic_Plane::set_minimum(const unsigned long int width,const unsigned long int height)
+{
+ if ((width>0)&&(height>0))
+ {
+  if ((width<=maximum_width)&&(height<=maximum_height))
+  {
+   minimum_width=width;
+   minimum_height=height;
+   this->apply_level();
+  }
+
+ }
+
+}
+
+void Dynamic_Plane::set_target_fps(const unsigned long int fps)
+{
+ budget=0;
+ if (fps>0) budget=1000000/fps;
+}
+
+unsigned long int Dynamic_Plane::get_level() const
+{
+ return level;
+}
+
+void Dynamic_Plane::transfer()
+{
+ unsigned long int elapsed;
+ this->Plane::transfer();
+ elapsed=this->get_elapsed();
+ if (budget>0) this->check_frame_time(elapsed);
+}
+
+Dynamic_Plane* Dynamic_Plane::get_handle()
+{
+ return this;
+}
+
+Layer::Layer()
+{
+ visible=true;
+ forced=true;
+ key=this->pack_pixel(255,0,255);
+ revision=0;
+ area.x=0;
+ area.y=0;
+ area.width=0;
+ area.height=0;
+}
+
+Layer::~Layer()
+{
+
+}
+
+void Layer::compose_area(unsigned short int *target)
+{
+ unsigned long int x,y,stop_x,stop_y;
+ size_t position;
+ const unsigned short int *source;
+ source=this->get_buffer();
+ stop_x=area.x+area.width;
+ stop_y=area.y+area.height;
+ for (y=area.y;y<stop_y;++y)
+ {
+  position=this->get_offset(0,y);
+  for (x=area.x;x<stop_x;++x)
+  {
+   if (source[position+x]!=key) target[position+x]=source[position+x];
+  }
+
+ }
+
+}
+
+void Layer::compose_full(unsigned short int *target)
+{
+ unsigned long int x,y,width,height,start_x,start_y,stop_x,stop_y;
+ size_t position;
+ const unsigned short int *source;
+ source=this->get_buffer();
+ width=this->get_frame_width();
+ height=this->get_frame_height();
+ start_x=width;
+ start_y=height;
+ stop_x=0;
+ stop_y=0;
+ for (y=0;y<height;++y)
+ {
+  position=this->get_offset(0,y);
+  for (x=0;x<width;++x)
+  {
+   if (source[position+x]!=key)
+   {
+    target[position+x]=source[position+x];
+    if (x<start_x) start_x=x;
+    if (x>=stop_x) stop_x=x+1;
+    if (y<start_y) start_y=y;
+    stop_y=y+1;
+   }
+
+  }
+
+ }
+ area.x=0;
+ area.y=0;
+ area.width=0;
+ area.height=0;
+ if (stop_x>0)
+ {
+  area.x=start_x;
+  area.y=start_y;
+  area.width=stop_x-start_x;
+  area.height=stop_y-start_y;
+ }
+
+}
+
+void Layer::create_layer(const unsigned long int width,const unsigned long int height)
+{
+ this->set_size(width,height);
+ this->create_buffers();
+ this->clear_layer();
+}
+
+void Layer::set_key(const unsigned char red,const unsigned char green,const unsigned char blue)
+{
+ key=this->pack_pixel(red,green,blue);
+ forced=true;
+}
+
+unsigned short int Layer::get_key() const
+{
+ return key;
+}
+
+void Layer::clear_layer()
+{
+ size_t index,amount;
+ unsigned short int *target;
+ target=this->get_buffer();
+ amount=this->get_pixels();
+ for (index=0;index<amount;++index)
+ {
+  target[index]=key;
+ }
+
+}
+
+void Layer::set_visible(const bool enabled)
+{
+ if (visible!=enabled) forced=true;
+ visible=enabled;
+}
+
+bool Layer::get_visible() const
+{
+ return visible;
+}
+
+bool Layer::is_changed() const
+{
+ return (forced==true)||(revision!=this->get_revision());
+}
+
+void Layer::compose(unsigned short int *target)
+{
+ if (visible==true)
+ {
+  if (this->is_changed()==true)
+  {
+   this->compose_full(target);
+  }
+  else
+  {
+   this->compose_area(target);
+  }
+
+ }
+ forced=false;
+ revision=this->get_revision();
+}
+
+Layer* Layer::get_handle()
+{
+ return this;
+}
+
 Timer::Timer()
 {
  interval=0;
@@ -354,6 +1132,23 @@ unsigned long int FPS::get_fps() const
 Render::Render()
 {
  start=0;
+ present=NULL;
+ band=NULL;
+ expanded=NULL;
+ stack=NULL;
+ composed=NULL;
+ layers=NULL;
+ layer_amount=0;
+ stacked=0;
+ base_revision=0;
+ window=NULL;
+ scroll_x=0;
+ scroll_y=0;
+ line_offsets=NULL;
+ line_levels=NULL;
+ line_hook=NULL;
+ hook_data=NULL;
+ prepared_level=USHRT_MAX;
  device=open("/dev/fb0",O_RDWR);
  if (device==-1)
  {
@@ -366,6 +1161,42 @@ Render::Render()
 Render::~Render()
 {
  if (device!=-1) close(device);
+ if (present!=NULL)
+ {
+  delete[] present;
+  present=NULL;
+ }
+ if (band!=NULL)
+ {
+  delete[] band;
+  band=NULL;
+ }
+ if (expanded!=NULL)
+ {
+  delete[] expanded;
+  expanded=NULL;
+ }
+ if (stack!=NULL)
+ {
+  delete[] stack;
+  stack=NULL;
+ }
+ if (composed!=NULL)
+ {
+  delete[] composed;
+  composed=NULL;
+ }
+ if (layers!=NULL)
+ {
+  delete[] layers;
+  layers=NULL;
+ }
+ if (window!=NULL)
+ {
+  delete[] window;
+  window=NULL;
+ }
+
 }
 
 void Render::read_base_configuration()
@@ -397,65 +1228,427 @@ void Render::get_start_offset()
  start=setting.xoffset*(setting.bits_per_pixel/CHAR_BIT)+setting.yoffset*configuration.line_length;
 }
 
-void Render::prepare_render()
+bool Render::check_raster() const
 {
- this->read_configuration();
- this->get_start_offset();
+ bool result;
+ result=false;
+ if ((line_offsets!=NULL)||(line_levels!=NULL)||(line_hook!=NULL))
+ {
+  result=true;
+ }
+ return result;
 }
 
-void Render::refresh()
+void Render::shift_line(const unsigned short int *source,unsigned short int *target,const long int offset)
 {
- lseek(device,start,SEEK_SET);
- write(device,this->get_buffer(),this->get_length());
+ size_t width,shift;
+ long int position;
+ width=static_cast<size_t>(this->get_width());
+ position=offset%static_cast<long int>(width);
+ if (position<0) position+=static_cast<long int>(width);
+ shift=static_cast<size_t>(position);
+ memcpy(target,source+shift,(width-shift)*sizeof(unsigned short int));
+ memcpy(target+(width-shift),source,shift*sizeof(unsigned short int));
 }
 
-unsigned long int Render::get_width() const
+void Render::prepare_levels(const unsigned char level)
 {
- return setting.xres;
-}
+ unsigned short int index;
+ if (prepared_level!=level)
+ {
+  prepared_level=level;
+  for (index=0;index<32;++index)
+  {
+   red_levels[index]=((index*level)/255) << 11;
+   blue_levels[index]=(index*level)/255;
+  }
+  for (index=0;index<64;++index)
+  {
+   green_levels[index]=((index*level)/255) << 5;
+  }
 
-unsigned long int Render::get_height() const
-{
- return setting.yres;
-}
+ }
 
-unsigned long int Render::get_color() const
-{
- return setting.bits_per_pixel;
 }
 
-Screen::Screen()
+void Render::apply_level(unsigned short int *target,const unsigned char level)
 {
+ unsigned long int index,width;
+ unsigned short int pixel;
+ width=this->get_width();
+ this->prepare_levels(level);
+ for (index=0;index<width;++index)
+ {
+  pixel=target[index];
+  target[index]=red_levels[pixel >> 11]|green_levels[(pixel >> 5)&63]|blue_levels[pixel&31];
+ }
 
 }
 
-Screen::~Screen()
+void Render::apply_raster(const unsigned short int *source_buffer,unsigned short int *target_buffer,const unsigned long int first,const unsigned long int amount)
 {
+ unsigned long int line,index,width;
+ const unsigned short int *source;
+ unsigned short int *target;
+ width=this->get_width();
+ for (index=0;index<amount;++index)
+ {
+  line=first+index;
+  source=source_buffer+this->get_offset(0,index,width);
+  target=target_buffer+this->get_offset(0,index,width);
+  if (line_offsets!=NULL)
+  {
+   this->shift_line(source,target,line_offsets[line]);
+  }
+  else
+  {
+   memcpy(target,source,static_cast<size_t>(width)*sizeof(unsigned short int));
+  }
+  if (line_levels!=NULL)
+  {
+   if (line_levels[line]<UCHAR_MAX) this->apply_level(target,line_levels[line]);
+  }
+  if (line_hook!=NULL) line_hook(line,target,width,hook_data);
+ }
 
 }
 
-void Screen::initialize()
-{
- this->prepare_render();
- this->set_size(this->get_width(),this->get_height());
- this->create_buffers();
-}
-
-void Screen::update()
+void Render::resize_layers()
 {
- this->refresh();
- this->update_counter();
+ Layer **target;
+ unsigned long int index;
+ target=NULL;
+ try
+ {
+  target=new Layer*[layer_amount+1];
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for layer list");
+ }
+ for (index=0;index<layer_amount;++index)
+ {
+  target[index]=layers[index];
+ }
+ if (layers!=NULL) delete[] layers;
+ layers=target;
 }
 
-Screen* Screen::get_handle()
+unsigned short int *Render::compose_layers(const unsigned short int *source)
 {
- return this;
-}
+ unsigned long int index,first;
+ unsigned short int *output;
+ if (stack==NULL) stack=this->create_buffer("Can't allocate memory for layer stack");
+ if (composed==NULL) composed=this->create_buffer("Can't allocate memory for composed frame");
+ first=0;
+ if (base_revision==this->get_revision())
+ {
+  for (first=0;first<layer_amount;++first)
+  {
+   if (layers[first]->is_changed()==true) break;
+  }
 
-Gamepad::Gamepad()
-{
- current=NULL;
- preversion=NULL;
+ }
+ else
+ {
+  stacked=layer_amount+1;
+ }
+ if (first<stacked)
+ {
+  memcpy(stack,source,this->get_length());
+  stacked=0;
+ }
+ for (index=stacked;index<first;++index)
+ {
+  layers[index]->compose(stack);
+ }
+ stacked=first;
+ output=stack;
+ if (stacked<layer_amount)
+ {
+  memcpy(composed,stack,this->get_length());
+  for (index=stacked;index<layer_amount;++index)
+  {
+   layers[index]->compose(composed);
+  }
+  output=composed;
+ }
+ base_revision=this->get_revision();
+ return output;
+}
+
+void Render::copy_piece(const unsigned short int *source,const unsigned long int x,const unsigned long int y,const unsigned long int target_x,const unsigned long int target_y,const unsigned long int width,const unsigned long int height)
+{
+ unsigned long int line;
+ for (line=0;line<height;++line)
+ {
+  memcpy(window+this->get_offset(target_x,target_y+line,this->get_width()),source+this->get_offset(x,y+line),static_cast<size_t>(width)*sizeof(unsigned short int));
+ }
+
+}
+
+unsigned short int *Render::copy_window(const unsigned short int *source)
+{
+ unsigned long int left,top,right,bottom;
+ if (window==NULL)
+ {
+  try
+  {
+   window=new unsigned short int[static_cast<size_t>(this->get_width())*static_cast<size_t>(this->get_height())];
+  }
+  catch (...)
+  {
+   Halt("Can't allocate memory for scroll window");
+  }
+
+ }
+ left=this->get_frame_width()-scroll_x;
+ top=this->get_frame_height()-scroll_y;
+ if (left>this->get_width()) left=this->get_width();
+ if (top>this->get_height()) top=this->get_height();
+ right=this->get_width()-left;
+ bottom=this->get_height()-top;
+ this->copy_piece(source,scroll_x,scroll_y,0,0,left,top);
+ if (right>0) this->copy_piece(source,0,scroll_y,left,0,right,top);
+ if (bottom>0) this->copy_piece(source,scroll_x,0,0,top,left,bottom);
+ if ((right>0)&&(bottom>0)) this->copy_piece(source,0,0,left,top,right,bottom);
+ return window;
+}
+
+void Render::prepare_render()
+{
+ this->read_configuration();
+ this->get_start_offset();
+}
+
+void Render::present_indexes()
+{
+ unsigned long int line,amount,width,height;
+ size_t length;
+ unsigned short int *output;
+ width=this->get_width();
+ height=this->get_height();
+ length=static_cast<size_t>(width)*BAND_LINES;
+ if (band==NULL)
+ {
+  try
+  {
+   band=new unsigned short int[2*length];
+  }
+  catch (...)
+  {
+   Halt("Can't allocate memory for present buffer");
+  }
+
+ }
+ lseek(device,start,SEEK_SET);
+ for (line=0;line<height;line+=amount)
+ {
+  amount=height-line;
+  if (amount>BAND_LINES) amount=BAND_LINES;
+  this->expand_indexes(band,this->get_offset(0,line),static_cast<size_t>(amount)*static_cast<size_t>(width));
+  output=band;
+  if (this->check_raster()==true)
+  {
+   this->apply_raster(band,band+length,line,amount);
+   output=band+length;
+  }
+  write(device,output,static_cast<size_t>(amount)*static_cast<size_t>(width)*sizeof(unsigned short int));
+ }
+
+}
+
+void Render::refresh()
+{
+ unsigned short int *output;
+ if ((this->is_indexed()==true)&&(layer_amount==0))
+ {
+  this->present_indexes();
+ }
+ else
+ {
+  output=this->get_render_buffer();
+  if (this->is_indexed()==true)
+  {
+   if (expanded==NULL) expanded=this->create_buffer("Can't allocate memory for expanded frame");
+   this->expand_indexes(expanded,0,this->get_pixels());
+   output=expanded;
+  }
+  if (layer_amount>0) output=this->compose_layers(output);
+  if (this->is_scrolling()==true) output=this->copy_window(output);
+  if (this->check_raster()==true)
+  {
+   if (present==NULL) present=this->create_buffer("Can't allocate memory for present buffer");
+   this->apply_raster(output,present,0,this->get_height());
+   output=present;
+  }
+  lseek(device,start,SEEK_SET);
+  write(device,output,static_cast<size_t>(this->get_width())*static_cast<size_t>(this->get_height())*sizeof(unsigned short int));
+ }
+ this->reset_effects();
+}
+
+unsigned long int Render::get_width() const
+{
+ return setting.xres;
+}
+
+unsigned long int Render::get_height() const
+{
+ return setting.yres;
+}
+
+unsigned long int Render::get_color() const
+{
+ return setting.bits_per_pixel;
+}
+
+void Render::set_raster_offsets(const long int *offsets)
+{
+ line_offsets=offsets;
+}
+
+void Render::set_raster_levels(const unsigned char *levels)
+{
+ line_levels=levels;
+}
+
+void Render::set_raster_hook(RASTER_CALLBACK hook,void *data)
+{
+ line_hook=hook;
+ hook_data=data;
+}
+
+void Render::disable_raster()
+{
+ line_offsets=NULL;
+ line_levels=NULL;
+ line_hook=NULL;
+ hook_data=NULL;
+}
+
+void Render::add_layer(Layer *target)
+{
+ if ((target->get_frame_width()!=this->get_frame_width())||(target->get_frame_height()!=this->get_frame_height()))
+ {
+  Halt("The layer size doesn't match the screen size");
+ }
+ this->resize_layers();
+ layers[layer_amount]=target;
+ ++layer_amount;
+ stacked=layer_amount+1;
+}
+
+void Render::remove_layer(Layer *target)
+{
+ unsigned long int index;
+ for (index=0;index<layer_amount;++index)
+ {
+  if (layers[index]==target) break;
+ }
+ if (index<layer_amount)
+ {
+  for (++index;index<layer_amount;++index)
+  {
+   layers[index-1]=layers[index];
+  }
+  --layer_amount;
+  stacked=layer_amount+1;
+ }
+
+}
+
+unsigned long int Render::get_layer_amount() const
+{
+ return layer_amount;
+}
+
+bool Render::is_scrolling() const
+{
+ return (this->get_frame_width()!=this->get_width())||(this->get_frame_height()!=this->get_height());
+}
+
+void Render::set_scroll(const long int x,const long int y)
+{
+ long int width,height;
+ width=static_cast<long int>(this->get_frame_width());
+ height=static_cast<long int>(this->get_frame_height());
+ if ((width>0)&&(height>0))
+ {
+  scroll_x=static_cast<unsigned long int>(((x%width)+width)%width);
+  scroll_y=static_cast<unsigned long int>(((y%height)+height)%height);
+ }
+
+}
+
+unsigned long int Render::get_scroll_x() const
+{
+ return scroll_x;
+}
+
+unsigned long int Render::get_scroll_y() const
+{
+ return scroll_y;
+}
+
+Collision_Box Render::get_view() const
+{
+ Collision_Box target;
+ target.x=scroll_x;
+ target.y=scroll_y;
+ target.width=this->get_width();
+ target.height=this->get_height();
+ return target;
+}
+
+Screen::Screen()
+{
+
+}
+
+Screen::~Screen()
+{
+
+}
+
+void Screen::initialize()
+{
+ this->prepare_render();
+ this->set_size(this->get_width(),this->get_height());
+ this->create_buffers();
+}
+
+void Screen::initialize_indexed()
+{
+ this->prepare_render();
+ this->set_size(this->get_width(),this->get_height());
+ this->create_indexed_buffers();
+}
+
+void Screen::initialize_scrolling(const unsigned long int width,const unsigned long int height)
+{
+ this->prepare_render();
+ this->set_size(width,height);
+ if (width<this->get_width()) this->set_size(this->get_width(),height);
+ if (height<this->get_height()) this->set_size(this->get_frame_width(),this->get_height());
+ this->create_buffers();
+}
+
+void Screen::update()
+{
+ this->refresh();
+ this->update_counter();
+}
+
+Screen* Screen::get_handle()
+{
+ return this;
+}
+
+Gamepad::Gamepad()
+{
+ current=NULL;
+ preversion=NULL;
  device=-1;
  length=sizeof(input_event);
  memset(&input,0,length);
@@ -1174,55 +2367,424 @@ bool Binary_File::check_error()
 
 Input_File::Input_File()
 {
-
+ memset(&head,0,sizeof(LZ_head));
+ blocks=NULL;
+ packed=NULL;
+ unpacked=NULL;
+ unpacked_length=0;
+ current=ULONG_MAX;
+ offset=0;
+ compressed=false;
 }
 
 Input_File::~Input_File()
 {
-
+ this->free_compression();
 }
 
-void Input_File::open(const char *name)
+void Input_File::free_compression()
 {
- this->close();
- this->open_file(name,"rb");
+ if (blocks!=NULL)
+ {
+  delete[] blocks;
+  blocks=NULL;
+ }
+ if (packed!=NULL)
+ {
+  delete[] packed;
+  packed=NULL;
+ }
+ if (unpacked!=NULL)
+ {
+  delete[] unpacked;
+  unpacked=NULL;
+ }
+ memset(&head,0,sizeof(LZ_head));
+ unpacked_length=0;
+ current=ULONG_MAX;
+ offset=0;
+ compressed=false;
 }
 
-void Input_File::read(void *buffer,const size_t length)
+void Input_File::check_compression()
 {
- fread(buffer,sizeof(char),length,target);
-}
+ unsigned long int index;
+ size_t length;
+ bool found;
+ found=false;
+ if (fread(&head,sizeof(LZ_head),1,target)==1) found=strncmp(head.signature,"GLZ1",4)==0;
+ if (found==false)
+ {
+  memset(&head,0,sizeof(LZ_head));
+  rewind(target);
+ }
+ else
+ {
+  if ((head.block==0)||(head.block>65536)||(head.amount!=head.length/head.block+((head.length%head.block)!=0)))
+  {
+   Halt("Invalid compressed file");
+  }
+  if (head.amount>(static_cast<unsigned long int>(Binary_File::get_length())-sizeof(LZ_head))/sizeof(LZ_Block))
+  {
+   Halt("Invalid compressed file");
+  }
+  fseek(target,sizeof(LZ_head),SEEK_SET);
+  try
+  {
+   blocks=new LZ_Block[static_cast<size_t>(head.amount)+1];
+   packed=new unsigned char[head.block];
+   unpacked=new unsigned char[head.block];
+  }
+  catch (...)
+  {
+   Halt("Can't allocate memory for decompression buffer");
+  }
+  memset(blocks,0,(static_cast<size_t>(head.amount)+1)*sizeof(LZ_Block));
+  if (fread(blocks,sizeof(LZ_Block),head.amount,target)!=head.amount)
+  {
+   Halt("Invalid compressed file");
+  }
+  for (index=0;index<head.amount;++index)
+  {
+   length=head.length-static_cast<size_t>(index)*head.block;
+   if (length>head.block) length=head.block;
+   if ((blocks[index].length==0)||(blocks[index].length>length))
+   {
+    Halt("Invalid compressed file");
+   }
 
-Output_File::Output_File()
-{
+  }
+  compressed=true;
+ }
 
 }
 
-Output_File::~Output_File()
+bool Input_File::decompress_block(const size_t length,const size_t target_length)
 {
+ const unsigned char *input;
+ const unsigned char *stop;
+ unsigned char *output;
+ unsigned char *output_stop;
+ const unsigned char *match;
+ size_t literals,amount,distance;
+ unsigned char token,value;
+ input=packed;
+ stop=packed+length;
+ output=unpacked;
+ output_stop=unpacked+target_length;
+ while (input<stop)
+ {
+  token=*input;
+  ++input;
+  literals=token >> 4;
+  if (literals==15)
+  {
+   do
+   {
+    if (input==stop) return false;
+    value=*input;
+    ++input;
+    literals+=value;
+   } while (value==255);
 
-}
+  }
+  if ((literals>static_cast<size_t>(stop-input))||(literals>static_cast<size_t>(output_stop-output))) return false;
+  memcpy(output,input,literals);
+  input+=literals;
+  output+=literals;
+  if (input==stop) break;
+  if ((stop-input)<2) return false;
+  distance=static_cast<size_t>(input[0])+(static_cast<size_t>(input[1]) << 8);
+  input+=2;
+  amount=(token&15)+4;
+  if ((token&15)==15)
+  {
+   do
+   {
+    if (input==stop) return false;
+    value=*input;
+    ++input;
+    amount+=value;
+   } while (value==255);
 
-void Output_File::open(const char *name)
-{
- this->close();
- this->open_file(name,"wb");
+  }
+  if ((distance==0)||(distance>static_cast<size_t>(output-unpacked))||(amount>static_cast<size_t>(output_stop-output))) return false;
+  match=output-distance;
+  if (distance>=amount)
+  {
+   memcpy(output,match,amount);
+   output+=amount;
+  }
+  else
+  {
+   for (;amount>0;--amount)
+   {
+    *output=*match;
+    ++output;
+    ++match;
+   }
+
+  }
+
+ }
+ return output==output_stop;
 }
 
-void Output_File::create_temp()
+void Input_File::load_block(const unsigned long int block)
 {
- this->close();
- target=tmpfile();
- if (target==NULL)
+ size_t length;
+ if (block>=head.amount)
  {
-  Halt("Can't create a temporary file");
+  Halt("Can't decompress the file");
  }
+ length=head.length-static_cast<size_t>(block)*head.block;
+ if (length>head.block) length=head.block;
+ fseek(target,blocks[block].offset,SEEK_SET);
+ if (blocks[block].length==length)
+ {
+  if (fread(unpacked,sizeof(unsigned char),length,target)!=length)
+  {
+   Halt("Can't decompress the file");
+  }
+
+ }
+ else
+ {
+  if (fread(packed,sizeof(unsigned char),blocks[block].length,target)!=blocks[block].length)
+  {
+   Halt("Can't decompress the file");
+  }
+  if (this->decompress_block(blocks[block].length,length)==false)
+  {
+   Halt("Can't decompress the file");
+  }
 
+ }
+ unpacked_length=length;
+ current=block;
 }
 
-void Output_File::write(void *buffer,const size_t length)
+size_t Input_File::read_data(void *buffer,const size_t length)
 {
- fwrite(buffer,sizeof(char),length,target);
+ unsigned char *output;
+ unsigned long int block;
+ size_t piece,start,left;
+ if (compressed==false) return fread(buffer,sizeof(unsigned char),length,target);
+ output=static_cast<unsigned char*>(buffer);
+ left=length;
+ while (left>0)
+ {
+  if (offset>=static_cast<long int>(head.length)) break;
+  block=offset/head.block;
+  if (block!=current) this->load_block(block);
+  start=offset-static_cast<long int>(block)*head.block;
+  piece=unpacked_length-start;
+  if (piece>left) piece=left;
+  memcpy(output,unpacked+start,piece);
+  output+=piece;
+  offset+=piece;
+  left-=piece;
+ }
+ return length-left;
+}
+
+void Input_File::open(const char *name)
+{
+ this->close();
+ this->open_file(name,"rb");
+ this->check_compression();
+}
+
+void Input_File::close()
+{
+ this->free_compression();
+ Binary_File::close();
+}
+
+void Input_File::read(void *buffer,const size_t length)
+{
+ this->read_data(buffer,length);
+}
+
+void Input_File::set_position(const long int position)
+{
+ if (compressed==true)
+ {
+  offset=position;
+  if (offset<0) offset=0;
+ }
+ else
+ {
+  Binary_File::set_position(position);
+ }
+
+}
+
+long int Input_File::get_position()
+{
+ if (compressed==true) return offset;
+ return Binary_File::get_position();
+}
+
+long int Input_File::get_length()
+{
+ if (compressed==true)
+ {
+  offset=0;
+  return head.length;
+ }
+ return Binary_File::get_length();
+}
+
+bool Input_File::is_compressed() const
+{
+ return compressed;
+}
+
+void Input_File::swap_file(Input_File &source)
+{
+ FILE *file;
+ LZ_head setting;
+ LZ_Block *table;
+ unsigned char *buffer;
+ size_t length;
+ unsigned long int block;
+ long int position;
+ bool state;
+ file=target;
+ target=source.target;
+ source.target=file;
+ setting=head;
+ head=source.head;
+ source.head=setting;
+ table=blocks;
+ blocks=source.blocks;
+ source.blocks=table;
+ buffer=packed;
+ packed=source.packed;
+ source.packed=buffer;
+ buffer=unpacked;
+ unpacked=source.unpacked;
+ source.unpacked=buffer;
+ length=unpacked_length;
+ unpacked_length=source.unpacked_length;
+ source.unpacked_length=length;
+ block=current;
+ current=source.current;
+ source.current=block;
+ position=offset;
+ offset=source.offset;
+ source.offset=position;
+ state=compressed;
+ compressed=source.compressed;
+ source.compressed=state;
+}
+
+Input_Stream::Input_Stream()
+{
+ position=0;
+ amount=0;
+}
+
+Input_Stream::~Input_Stream()
+{
+
+}
+
+bool Input_Stream::fill_buffer()
+{
+ position=0;
+ amount=this->read_data(buffer,sizeof(buffer));
+ return amount>0;
+}
+
+void Input_Stream::start_stream()
+{
+ position=0;
+ amount=0;
+}
+
+size_t Input_Stream::get_available()
+{
+ if (position==amount) this->fill_buffer();
+ return amount-position;
+}
+
+const unsigned char *Input_Stream::get_current() const
+{
+ return buffer+position;
+}
+
+void Input_Stream::skip_bytes(const size_t length)
+{
+ position+=length;
+ if (position>amount) position=amount;
+}
+
+bool Input_Stream::read_byte(unsigned char &value)
+{
+ if (position==amount)
+ {
+  if (this->fill_buffer()==false) return false;
+ }
+ value=buffer[position];
+ ++position;
+ return true;
+}
+
+bool Input_Stream::read_block(void *block,const size_t length)
+{
+ unsigned char *output;
+ size_t piece,left;
+ output=static_cast<unsigned char*>(block);
+ left=length;
+ while (left>0)
+ {
+  if (position==amount)
+  {
+   if (left>=sizeof(buffer)) return this->read_data(output,left)==left;
+   if (this->fill_buffer()==false) return false;
+  }
+  piece=amount-position;
+  if (piece>left) piece=left;
+  memcpy(output,buffer+position,piece);
+  position+=piece;
+  output+=piece;
+  left-=piece;
+ }
+ return true;
+}
+
+Output_File::Output_File()
+{
+
+}
+
+Output_File::~Output_File()
+{
+
+}
+
+void Output_File::open(const char *name)
+{
+ this->close();
+ this->open_file(name,"wb");
+}
+
+void Output_File::create_temp()
+{
+ this->close();
+ target=tmpfile();
+ if (target==NULL)
+ {
+  Halt("Can't create a temporary file");
+ }
+
+}
+
+void Output_File::write(void *buffer,const size_t length)
+{
+ fwrite(buffer,sizeof(char),length,target);
 }
 
 void Output_File::flush()
@@ -1230,6 +2792,175 @@ void Output_File::flush()
  fflush(target);
 }
 
+LZ_Compressor::LZ_Compressor()
+{
+ memset(table,0,sizeof(table));
+}
+
+LZ_Compressor::~LZ_Compressor()
+{
+
+}
+
+unsigned long int LZ_Compressor::get_hash(const unsigned char *data) const
+{
+ unsigned long int value;
+ value=static_cast<unsigned long int>(data[0])+(static_cast<unsigned long int>(data[1]) << 8)+(static_cast<unsigned long int>(data[2]) << 16)+(static_cast<unsigned long int>(data[3]) << 24);
+ return ((value*2654435761UL)&0xFFFFFFFFUL) >> 20;
+}
+
+unsigned char *LZ_Compressor::write_length(unsigned char *output,size_t length) const
+{
+ while (length>=255)
+ {
+  *output=255;
+  ++output;
+  length-=255;
+ }
+ *output=static_cast<unsigned char>(length);
+ return output+1;
+}
+
+size_t LZ_Compressor::compress(const unsigned char *input,const size_t length,unsigned char *output,const size_t capacity)
+{
+ size_t index,anchor,literals,amount,reference;
+ unsigned long int hash;
+ unsigned char *target;
+ unsigned char *token;
+ target=output;
+ index=0;
+ anchor=0;
+ memset(table,0,sizeof(table));
+ while (index+4<=length)
+ {
+  hash=this->get_hash(input+index);
+  reference=table[hash];
+  table[hash]=index+1;
+  if (reference==0)
+  {
+   ++index;
+   continue;
+  }
+  --reference;
+  if (((index-reference)>65535)||(memcmp(input+reference,input+index,4)!=0))
+  {
+   ++index;
+   continue;
+  }
+  amount=4;
+  while ((index+amount<length)&&(input[reference+amount]==input[index+amount])) ++amount;
+  literals=index-anchor;
+  if ((literals+amount/255+literals/255+8)>(capacity-static_cast<size_t>(target-output))) return 0;
+  token=target;
+  ++target;
+  if (literals>=15)
+  {
+   *token=15 << 4;
+   target=this->write_length(target,literals-15);
+  }
+  else
+  {
+   *token=literals << 4;
+  }
+  memcpy(target,input+anchor,literals);
+  target+=literals;
+  target[0]=(index-reference)&255;
+  target[1]=(index-reference) >> 8;
+  target+=2;
+  if ((amount-4)>=15)
+  {
+   *token|=15;
+   target=this->write_length(target,amount-19);
+  }
+  else
+  {
+   *token|=amount-4;
+  }
+  index+=amount;
+  anchor=index;
+ }
+ literals=length-anchor;
+ if ((literals+literals/255+2)>(capacity-static_cast<size_t>(target-output))) return 0;
+ token=target;
+ ++target;
+ if (literals>=15)
+ {
+  *token=15 << 4;
+  target=this->write_length(target,literals-15);
+ }
+ else
+ {
+  *token=literals << 4;
+ }
+ memcpy(target,input+anchor,literals);
+ target+=literals;
+ return target-output;
+}
+
+void LZ_Compressor::compress_file(const char *source,const char *target)
+{
+ Input_File input;
+ Output_File output;
+ LZ_head head;
+ LZ_Block *blocks;
+ unsigned char *block;
+ unsigned char *packed;
+ unsigned long int index;
+ size_t length,amount,position;
+ blocks=NULL;
+ block=NULL;
+ packed=NULL;
+ input.open(source);
+ memset(&head,0,sizeof(LZ_head));
+ memcpy(head.signature,"GLZ1",4);
+ head.length=input.get_length();
+ head.block=65536;
+ head.amount=(static_cast<size_t>(head.length)+head.block-1)/head.block;
+ try
+ {
+  blocks=new LZ_Block[head.amount+1];
+  block=new unsigned char[head.block];
+  packed=new unsigned char[head.block];
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for compression buffer");
+ }
+ memset(blocks,0,static_cast<size_t>(head.amount+1)*sizeof(LZ_Block));
+ output.open(target);
+ output.write(&head,sizeof(LZ_head));
+ output.write(blocks,static_cast<size_t>(head.amount)*sizeof(LZ_Block));
+ position=sizeof(LZ_head)+static_cast<size_t>(head.amount)*sizeof(LZ_Block);
+ for (index=0;index<head.amount;++index)
+ {
+  length=head.length-static_cast<size_t>(index)*head.block;
+  if (length>head.block) length=head.block;
+  input.read(block,length);
+  amount=this->compress(block,length,packed,length-1);
+  blocks[index].offset=position;
+  if (amount==0)
+  {
+   blocks[index].length=length;
+   output.write(block,length);
+   position+=length;
+  }
+  else
+  {
+   blocks[index].length=amount;
+   output.write(packed,amount);
+   position+=amount;
+  }
+
+ }
+ output.set_position(sizeof(LZ_head));
+ output.write(blocks,static_cast<size_t>(head.amount)*sizeof(LZ_Block));
+ output.close();
+ input.close();
+ delete[] blocks;
+ delete[] block;
+ delete[] packed;
+}
+
 Audio::Audio()
 {
  memset(&head,0,44);
@@ -1346,6 +3077,15 @@ void Audio::go_start()
  target.set_position(44);
 }
 
+void Audio::swap_audio(Audio &source)
+{
+ WAVE_head setting;
+ target.swap_file(source.target);
+ setting=head;
+ head=source.head;
+ source.head=setting;
+}
+
 Player::Player()
 {
  sound=NULL;
@@ -1464,9 +3204,9 @@ Primitive::~Primitive()
 
 }
 
-void Primitive::initialize(Screen *screen)
+void Primitive::initialize(Frame *target)
 {
- surface=screen;
+ surface=target;
 }
 
 void Primitive::set_color(const unsigned char red,const unsigned char green,const unsigned char blue)
@@ -1543,6 +3283,8 @@ Image::Image()
  width=0;
  height=0;
  data=NULL;
+ palette=NULL;
+ kind=TRUECOLOR_IMAGE;
 }
 
 Image::~Image()
@@ -1552,6 +3294,11 @@ Image::~Image()
   delete[] data;
   data=NULL;
  }
+ if (palette!=NULL)
+ {
+  delete[] palette;
+  palette=NULL;
+ }
 
 }
 
@@ -1577,1032 +3324,5362 @@ void Image::clear_buffer()
   delete[] data;
   data=NULL;
  }
+ if (palette!=NULL)
+ {
+  delete[] palette;
+  palette=NULL;
+ }
+ kind=TRUECOLOR_IMAGE;
+}
 
+void Image::create_palette()
+{
+ palette=this->create_buffer(768);
+ memset(palette,0,768);
+ kind=INDEXED_IMAGE;
 }
 
-void Image::load_tga(const char *name)
+void Image::convert_palette(unsigned short int *target) const
 {
- Input_File target;
- size_t index,position,amount,compressed_length,uncompressed_length;
- unsigned char *compressed;
- unsigned char *uncompressed;
- TGA_head head;
- TGA_map color_map;
- TGA_image image;
- this->clear_buffer();
- target.open(name);
- compressed_length=static_cast<size_t>(target.get_length()-18);
- target.read(&head,3);
- target.read(&color_map,5);
- target.read(&image,10);
- if ((head.color_map!=0)||(image.color!=24))
- {
-  Halt("Invalid image format");
- }
- if (head.type!=2)
+ size_t index;
+ if (palette!=NULL)
  {
-  if (head.type!=10)
+  for (index=0;index<256;++index)
   {
-   Halt("Invalid image format");
+   target[index]=this->convert_pixel(palette+index*3);
   }
 
  }
- index=0;
- position=0;
- width=image.width;
- height=image.height;
- uncompressed_length=this->get_length();
- uncompressed=this->create_buffer(uncompressed_length);
- if (head.type==2)
+
+}
+
+unsigned short int Image::convert_pixel(const unsigned char *pixel) const
+{
+ return (pixel[0] >> 3)+((pixel[1] >> 2) << 5)+((pixel[2] >> 3) << 11); // This code bases on code from SVGALib
+}
+
+void Image::fill_pixels(unsigned char *target,const size_t depth,const size_t length) const
+{
+ size_t filled,piece;
+ if (length<=16)
  {
-  target.read(uncompressed,uncompressed_length);
+  for (filled=depth;filled<length;++filled)
+  {
+   target[filled]=target[filled-depth];
+  }
+
  }
- if (head.type==10)
+ else
  {
-  compressed=this->create_buffer(compressed_length);
-  target.read(compressed,compressed_length);
-  while(index<uncompressed_length)
+  filled=depth;
+  while (filled<length)
   {
-   if (compressed[position]<128)
-   {
-    amount=compressed[position]+1;
-    amount*=3;
-    memmove(uncompressed+index,compressed+(position+1),amount);
-    index+=amount;
-    position+=1+amount;
-   }
-   else
-   {
-    for (amount=compressed[position]-127;amount>0;--amount)
-    {
-     memmove(uncompressed+index,compressed+(position+1),3);
-     index+=3;
-    }
-    position+=4;
-   }
-
+   piece=filled;
+   if (piece>length-filled) piece=length-filled;
+   memcpy(target+filled,target,piece);
+   filled+=piece;
   }
-  delete[] compressed;
+
  }
- target.close();
- data=uncompressed;
+
 }
 
-void Image::load_pcx(const char *name)
+void Image::store_pixels(unsigned char *output,unsigned short int *native,const size_t index,const unsigned char *source,const size_t length,const size_t depth,const bool repeat) const
 {
- Input_File target;
- unsigned long int x,y;
- size_t index,position,line,row,length,uncompressed_length;
- unsigned char repeat;
- unsigned char *original;
- unsigned char *uncompressed;
- PCX_head head;
- this->clear_buffer();
- target.open(name);
- length=static_cast<size_t>(target.get_length()-128);
- target.read(&head,128);
- if ((head.color*head.planes!=24)&&(head.compress!=1))
+ size_t position,amount;
+ if (native==NULL)
  {
-  Halt("Incorrect image format");
+  amount=length;
+  if (repeat==true) amount=depth;
+  if (amount<=16)
+  {
+   for (position=0;position<amount;++position)
+   {
+    output[index+position]=source[position];
+   }
+
+  }
+  else
+  {
+   memcpy(output+index,source,amount);
+  }
+  if (repeat==true) this->fill_pixels(output+index,depth,length);
  }
- width=head.max_x-head.min_x+1;
- height=head.max_y-head.min_y+1;
- row=static_cast<size_t>(width)*3;
- line=static_cast<size_t>(head.planes)*static_cast<size_t>(head.plane_length);
- uncompressed_length=row*height;
- index=0;
- position=0;
- original=this->create_buffer(length);
- uncompressed=this->create_buffer(uncompressed_length);
- target.read(original,length);
- target.close();
- while (index<length)
+ else
  {
-  if (original[index]<192)
+  native+=index/depth;
+  amount=length/depth;
+  if (repeat==true)
   {
-   uncompressed[position]=original[index];
-   ++position;
-   ++index;
+   native[0]=(depth==1) ? colors[source[0]]:this->convert_pixel(source);
+   for (position=1;position<amount;++position)
+   {
+    native[position]=native[0];
+   }
+
   }
   else
   {
-   for (repeat=original[index]-192;repeat>0;--repeat)
+   for (position=0;position<amount;++position)
    {
-    uncompressed[position]=original[index+1];
-    ++position;
+    native[position]=(depth==1) ? colors[source[position]]:this->convert_pixel(source+position*depth);
    }
-   index+=2;
+
+  }
+
+ }
+
+}
+
+void Image::read_pixels(Input_Stream &target,unsigned char *output,unsigned short int *native,const size_t depth,const size_t length) const
+{
+ size_t index,amount;
+ unsigned char piece[384];
+ if (native==NULL)
+ {
+  if (target.read_block(output,length)==false)
+  {
+   Halt("Invalid image format");
   }
 
  }
- delete[] original;
- original=this->create_buffer(uncompressed_length);
- for (x=0;x<width;++x)
+ else
  {
-  for (y=0;y<height;++y)
+  for (index=0;index<length;index+=amount)
   {
-   index=static_cast<size_t>(x)*3+static_cast<size_t>(y)*row;
-   position=static_cast<size_t>(x)+static_cast<size_t>(y)*line;
-   original[index]=uncompressed[position+2*static_cast<size_t>(head.plane_length)];
-   original[index+1]=uncompressed[position+static_cast<size_t>(head.plane_length)];
-   original[index+2]=uncompressed[position];
+   amount=128*depth;
+   if (amount>length-index) amount=length-index;
+   if (target.read_block(piece,amount)==false)
+   {
+    Halt("Invalid image format");
+   }
+   this->store_pixels(NULL,native,index,piece,amount,depth,false);
   }
 
  }
- delete[] uncompressed;
- data=original;
+
 }
 
-unsigned long int Image::get_width() const
+void Image::decode_tga(Input_Stream &target,unsigned char *output,unsigned short int *native,const size_t depth,const size_t length) const
 {
- return width;
+ size_t index,amount,available,used,packet_length;
+ const unsigned char *current;
+ unsigned char packet;
+ unsigned char piece[384];
+ index=0;
+ while (index<length)
+ {
+  available=target.get_available();
+  if (available==0)
+  {
+   Halt("Invalid image format");
+  }
+  current=target.get_current();
+  used=0;
+  while ((index<length)&&(used<available))
+  {
+   packet=current[used];
+   amount=static_cast<size_t>(packet&127)+1;
+   amount*=depth;
+   if (amount>length-index)
+   {
+    Halt("Invalid image format");
+   }
+   packet_length=depth;
+   if (packet<128) packet_length=amount;
+   if (used+packet_length>=available) break;
+   this->store_pixels(output,native,index,current+used+1,amount,depth,packet>=128);
+   used+=packet_length+1;
+   index+=amount;
+  }
+  target.skip_bytes(used);
+  if ((index<length)&&(used<available))
+  {
+   target.skip_bytes(1);
+   if (target.read_block(piece,packet_length)==false)
+   {
+    Halt("Invalid image format");
+   }
+   this->store_pixels(output,native,index,piece,amount,depth,packet>=128);
+   index+=amount;
+  }
+
+ }
+
+}
+
+void Image::decode_tga_row(Input_Stream &target,RLE_State &state,unsigned char *row,const size_t depth,const size_t length) const
+{
+ size_t index,amount;
+ unsigned char packet;
+ index=0;
+ while (index<length)
+ {
+  if (state.left==0)
+  {
+   if (target.read_byte(packet)==false)
+   {
+    Halt("Invalid image format");
+   }
+   state.left=static_cast<size_t>(packet&127)+1;
+   state.repeat=packet>=128;
+   if (state.repeat==true)
+   {
+    if (target.read_block(state.pixel,depth)==false)
+    {
+     Halt("Invalid image format");
+    }
+
+   }
+
+  }
+  amount=(length-index)/depth;
+  if (amount>state.left) amount=state.left;
+  if (state.repeat==true)
+  {
+   memcpy(row+index,state.pixel,depth);
+   this->fill_pixels(row+index,depth,amount*depth);
+  }
+  else
+  {
+   if (target.read_block(row+index,amount*depth)==false)
+   {
+    Halt("Invalid image format");
+   }
+
+  }
+  state.left-=amount;
+  index+=amount*depth;
+ }
+
+}
+
+void Image::scale_row(const unsigned char *row,unsigned char *output,unsigned short int *native,const size_t depth,const unsigned long int source_width,const unsigned long int target_width) const
+{
+ unsigned long int x,step,position;
+ const unsigned char *pixel;
+ if (source_width==target_width)
+ {
+  if (native!=NULL)
+  {
+   this->store_pixels(NULL,native,0,row,static_cast<size_t>(source_width)*depth,depth,false);
+  }
+  else
+  {
+   memcpy(output,row,static_cast<size_t>(source_width)*depth);
+  }
+
+ }
+ else
+ {
+  step=(source_width << 16)/target_width;
+  position=0;
+  for (x=0;x<target_width;++x)
+  {
+   pixel=row+static_cast<size_t>(position >> 16)*depth;
+   if (native!=NULL)
+   {
+    native[x]=(depth==1) ? colors[pixel[0]]:this->convert_pixel(pixel);
+   }
+   else
+   {
+    memcpy(output+static_cast<size_t>(x)*depth,pixel,depth);
+   }
+   position+=step;
+  }
+
+ }
+
+}
+
+void Image::scale_tga(Input_Stream &target,const bool compressed,unsigned char *output,unsigned short int *native,const size_t depth,const unsigned long int source_width,const unsigned long int source_height)
+{
+ unsigned long int y,source_y,step,position;
+ size_t row_length;
+ unsigned char *row;
+ RLE_State state;
+ row_length=static_cast<size_t>(source_width)*depth;
+ row=this->create_buffer(row_length);
+ state.left=0;
+ state.repeat=false;
+ step=(source_height << 16)/height;
+ position=0;
+ source_y=0;
+ if (compressed==true) this->decode_tga_row(target,state,row,depth,row_length); else this->read_pixels(target,row,NULL,depth,row_length);
+ for (y=0;y<height;++y)
+ {
+  while (source_y<(position >> 16))
+  {
+   if (compressed==true) this->decode_tga_row(target,state,row,depth,row_length); else this->read_pixels(target,row,NULL,depth,row_length);
+   ++source_y;
+  }
+  if (native!=NULL)
+  {
+   this->scale_row(row,NULL,native+static_cast<size_t>(y)*static_cast<size_t>(width),depth,source_width,width);
+  }
+  else
+  {
+   this->scale_row(row,output+static_cast<size_t>(y)*static_cast<size_t>(width)*depth,NULL,depth,source_width,width);
+  }
+  position+=step;
+ }
+ delete[] row;
+}
+
+void Image::decode_pcx_row(Input_Stream &target,RLE_State &state,unsigned char *line,const size_t length) const
+{
+ size_t index,amount;
+ unsigned char value;
+ index=0;
+ while (index<length)
+ {
+  if (state.left==0)
+  {
+   if (target.read_byte(value)==false)
+   {
+    Halt("Incorrect image format");
+   }
+   if (value<192)
+   {
+    line[index]=value;
+    ++index;
+    continue;
+   }
+   state.left=value-192;
+   if (target.read_byte(state.pixel[0])==false)
+   {
+    Halt("Incorrect image format");
+   }
+
+  }
+  amount=length-index;
+  if (amount>state.left) amount=state.left;
+  memset(line+index,state.pixel[0],amount);
+  state.left-=amount;
+  index+=amount;
+ }
+
+}
+
+void Image::merge_planes(const unsigned char *line,unsigned char *row,const unsigned long int source_width,const size_t plane_length) const
+{
+ unsigned long int x;
+ const unsigned char *red;
+ const unsigned char *green;
+ const unsigned char *blue;
+ red=line;
+ green=line+plane_length;
+ blue=green+plane_length;
+ for (x=0;x<source_width;++x)
+ {
+  row[0]=blue[x];
+  row[1]=green[x];
+  row[2]=red[x];
+  row+=3;
+ }
+
+}
+
+void Image::read_pcx_palette(Input_File &target)
+{
+ size_t index;
+ unsigned char swap;
+ this->create_palette();
+ target.set_position(target.get_length()-768);
+ target.read(palette,768);
+ for (index=0;index<768;index+=3)
+ {
+  swap=palette[index];
+  palette[index]=palette[index+2];
+  palette[index+2]=swap;
+ }
+ target.set_position(128);
+}
+
+void Image::check_output(const DECODE_TYPE mode,const size_t length) const
+{
+ if ((mode==DECODE_INDEXES)&&(kind!=INDEXED_IMAGE))
+ {
+  Halt("Invalid image format");
+ }
+ if (mode!=DECODE_IMAGE)
+ {
+  if (static_cast<size_t>(width)*static_cast<size_t>(height)>length)
+  {
+   Halt("The image buffer is too small");
+  }
+
+ }
+
+}
+
+void Image::read_tga(const char *name,const DECODE_TYPE mode,void *output,const size_t length,const unsigned long int target_width,const unsigned long int target_height)
+{
+ Input_Stream target;
+ size_t depth,uncompressed_length;
+ unsigned char *uncompressed;
+ unsigned short int *native;
+ TGA_head head;
+ TGA_map color_map;
+ TGA_image image;
+ this->clear_buffer();
+ target.open(name);
+ target.read(&head,3);
+ target.read(&color_map,5);
+ target.read(&image,10);
+ if (head.id>0) target.set_position(18+static_cast<long int>(head.id));
+ if ((head.color_map==0)&&(image.color==24))
+ {
+  if ((head.type!=2)&&(head.type!=10))
+  {
+   Halt("Invalid image format");
+  }
+
+ }
+ else
+ {
+  if ((head.color_map!=1)||(image.color!=8)||(color_map.map_size!=24))
+  {
+   Halt("Invalid image format");
+  }
+  if ((head.type!=1)&&(head.type!=9))
+  {
+   Halt("Invalid image format");
+  }
+  if (static_cast<size_t>(color_map.index)+static_cast<size_t>(color_map.length)>256)
+  {
+   Halt("Invalid image format");
+  }
+  this->create_palette();
+  target.read(palette+static_cast<size_t>(color_map.index)*3,static_cast<size_t>(color_map.length)*3);
+ }
+ width=image.width;
+ height=image.height;
+ depth=image.color/CHAR_BIT;
+ if (mode!=DECODE_HEAD)
+ {
+  if ((target_width>0)&&(target_height>0))
+  {
+   width=target_width;
+   height=target_height;
+  }
+  this->check_output(mode,length);
+  uncompressed_length=this->get_length();
+  uncompressed=NULL;
+  native=NULL;
+  switch (mode)
+  {
+   case DECODE_NATIVE:
+   native=static_cast<unsigned short int*>(output);
+   this->convert_palette(colors);
+   break;
+   case DECODE_INDEXES:
+   uncompressed=static_cast<unsigned char*>(output);
+   break;
+   default:
+   uncompressed=this->create_buffer(uncompressed_length);
+   data=uncompressed;
+   break;
+  }
+  target.start_stream();
+  if ((width!=image.width)||(height!=image.height))
+  {
+   this->scale_tga(target,(head.type==10)||(head.type==9),uncompressed,native,depth,image.width,image.height);
+  }
+  else
+  {
+   if ((head.type==2)||(head.type==1))
+   {
+    this->read_pixels(target,uncompressed,native,depth,uncompressed_length);
+   }
+   if ((head.type==10)||(head.type==9))
+   {
+    this->decode_tga(target,uncompressed,native,depth,uncompressed_length);
+   }
+
+  }
+
+ }
+ target.close();
+}
+
+void Image::read_pcx(const char *name,const DECODE_TYPE mode,void *output,const size_t length,const unsigned long int target_width,const unsigned long int target_height)
+{
+ Input_Stream target;
+ unsigned long int y,source_width,source_height,source_y,step,position;
+ size_t depth,line_length;
+ unsigned char *line;
+ unsigned char *row;
+ unsigned char *uncompressed;
+ unsigned short int *native;
+ RLE_State state;
+ PCX_head head;
+ this->clear_buffer();
+ target.open(name);
+ target.read(&head,128);
+ if ((head.color!=8)||(head.compress!=1))
+ {
+  Halt("Incorrect image format");
+ }
+ if ((head.planes!=3)&&(head.planes!=1))
+ {
+  Halt("Incorrect image format");
+ }
+ if ((head.max_x<head.min_x)||(head.max_y<head.min_y))
+ {
+  Halt("Incorrect image format");
+ }
+ source_width=head.max_x-head.min_x+1;
+ source_height=head.max_y-head.min_y+1;
+ if (head.plane_length<source_width)
+ {
+  Halt("Incorrect image format");
+ }
+ if (head.planes==1) this->read_pcx_palette(target);
+ width=source_width;
+ height=source_height;
+ if (mode!=DECODE_HEAD)
+ {
+  if ((target_width>0)&&(target_height>0))
+  {
+   width=target_width;
+   height=target_height;
+  }
+  this->check_output(mode,length);
+  depth=head.planes;
+  line_length=static_cast<size_t>(head.planes)*static_cast<size_t>(head.plane_length);
+  uncompressed=NULL;
+  native=NULL;
+  switch (mode)
+  {
+   case DECODE_NATIVE:
+   native=static_cast<unsigned short int*>(output);
+   this->convert_palette(colors);
+   break;
+   case DECODE_INDEXES:
+   uncompressed=static_cast<unsigned char*>(output);
+   break;
+   default:
+   uncompressed=this->create_buffer(this->get_length());
+   data=uncompressed;
+   break;
+  }
+  line=this->create_buffer(line_length);
+  row=line;
+  if (depth==3) row=this->create_buffer(static_cast<size_t>(source_width)*depth);
+  state.left=0;
+  state.repeat=true;
+  step=(source_height << 16)/height;
+  position=0;
+  source_y=0;
+  target.start_stream();
+  this->decode_pcx_row(target,state,line,line_length);
+  for (y=0;y<height;++y)
+  {
+   while (source_y<(position >> 16))
+   {
+    this->decode_pcx_row(target,state,line,line_length);
+    ++source_y;
+   }
+   if (depth==3) this->merge_planes(line,row,source_width,head.plane_length);
+   if (native!=NULL)
+   {
+    this->scale_row(row,NULL,native+static_cast<size_t>(y)*static_cast<size_t>(width),depth,source_width,width);
+   }
+   else
+   {
+    this->scale_row(row,uncompressed+static_cast<size_t>(y)*static_cast<size_t>(width)*depth,NULL,depth,source_width,width);
+   }
+   position+=step;
+  }
+  if (row!=line) delete[] row;
+  delete[] line;
+ }
+ target.close();
+}
+
+void Image::load_tga(const char *name)
+{
+ this->read_tga(name,DECODE_IMAGE,NULL,0,0,0);
+}
+
+void Image::load_pcx(const char *name)
+{
+ this->read_pcx(name,DECODE_IMAGE,NULL,0,0,0);
+}
+
+void Image::read_tga_head(const char *name)
+{
+ this->read_tga(name,DECODE_HEAD,NULL,0,0,0);
+}
+
+void Image::read_pcx_head(const char *name)
+{
+ this->read_pcx(name,DECODE_HEAD,NULL,0,0,0);
+}
+
+void Image::load_tga(const char *name,unsigned short int *target,const size_t length)
+{
+ this->read_tga(name,DECODE_NATIVE,target,length,0,0);
+}
+
+void Image::load_pcx(const char *name,unsigned short int *target,const size_t length)
+{
+ this->read_pcx(name,DECODE_NATIVE,target,length,0,0);
+}
+
+void Image::load_tga(const char *name,unsigned char *target,unsigned short int *target_palette,const size_t length)
+{
+ this->read_tga(name,DECODE_INDEXES,target,length,0,0);
+ this->convert_palette(target_palette);
+}
+
+void Image::load_pcx(const char *name,unsigned char *target,unsigned short int *target_palette,const size_t length)
+{
+ this->read_pcx(name,DECODE_INDEXES,target,length,0,0);
+ this->convert_palette(target_palette);
+}
+
+void Image::load_tga(const char *name,const unsigned long int target_width,const unsigned long int target_height)
+{
+ this->read_tga(name,DECODE_IMAGE,NULL,0,target_width,target_height);
+}
+
+void Image::load_tga(const char *name,unsigned short int *target,const size_t length,const unsigned long int target_width,const unsigned long int target_height)
+{
+ this->read_tga(name,DECODE_NATIVE,target,length,target_width,target_height);
+}
+
+void Image::load_tga(const char *name,unsigned char *target,unsigned short int *target_palette,const size_t length,const unsigned long int target_width,const unsigned long int target_height)
+{
+ this->read_tga(name,DECODE_INDEXES,target,length,target_width,target_height);
+ this->convert_palette(target_palette);
+}
+
+void Image::load_pcx(const char *name,const unsigned long int target_width,const unsigned long int target_height)
+{
+ this->read_pcx(name,DECODE_IMAGE,NULL,0,target_width,target_height);
+}
+
+void Image::load_pcx(const char *name,unsigned short int *target,const size_t length,const unsigned long int target_width,const unsigned long int target_height)
+{
+ this->read_pcx(name,DECODE_NATIVE,target,length,target_width,target_height);
+}
+
+void Image::load_pcx(const char *name,unsigned char *target,unsigned short int *target_palette,const size_t length,const unsigned long int target_width,const unsigned long int target_height)
+{
+ this->read_pcx(name,DECODE_INDEXES,target,length,target_width,target_height);
+ this->convert_palette(target_palette);
+}
+
+unsigned long int Image::get_width() const
+{
+ return width;
+}
+
+unsigned long int Image::get_height() const
+{
+ return height;
+}
+
+size_t Image::get_length() const
+{
+ size_t length;
+ length=static_cast<size_t>(width)*static_cast<size_t>(height);
+ if (kind==TRUECOLOR_IMAGE) length*=3;
+ return length;
+}
+
+unsigned char *Image::get_data()
+{
+ return data;
+}
+
+IMAGE_TYPE Image::get_type() const
+{
+ return kind;
+}
+
+unsigned char *Image::get_palette()
+{
+ return palette;
+}
+
+void Image::destroy_image()
+{
+ width=0;
+ height=0;
+ this->clear_buffer();
+}
+
+Surface::Surface()
+{
+ width=0;
+ height=0;
+ revision=0;
+ image=NULL;
+ indexes=NULL;
+ pixels=NULL;
+ borrowed=false;
+ current_palette=palette;
+ surface=NULL;
+ memset(palette,0,sizeof(palette));
+}
+
+Surface::~Surface()
+{
+ surface=NULL;
+ if (image!=NULL) free(image);
+ if (indexes!=NULL) free(indexes);
+ this->free_native();
+}
+
+void Surface::free_native()
+{
+ if (pixels!=NULL)
+ {
+  if (borrowed==false) free(pixels);
+  pixels=NULL;
+ }
+ borrowed=false;
+}
+
+void Surface::copy_pixel(IMG_Pixel *target_image,unsigned char *target_indexes,unsigned short int *target_pixels,const size_t location,const size_t position) const
+{
+ if (indexes!=NULL)
+ {
+  target_indexes[location]=indexes[position];
+ }
+ if (pixels!=NULL)
+ {
+  target_pixels[location]=pixels[position];
+ }
+ if (image!=NULL)
+ {
+  target_image[location]=image[position];
+ }
+
+}
+
+void Surface::replace_buffer(IMG_Pixel *target_image,unsigned char *target_indexes,unsigned short int *target_pixels)
+{
+ if (image!=NULL) free(image);
+ if (indexes!=NULL) free(indexes);
+ this->free_native();
+ image=target_image;
+ indexes=target_indexes;
+ pixels=target_pixels;
+ ++revision;
+}
+
+void Surface::load_file(const char *name,const bool pcx,const unsigned long int target_width,const unsigned long int target_height)
+{
+ Image buffer;
+ size_t length;
+ if (pcx==true) buffer.read_pcx_head(name); else buffer.read_tga_head(name);
+ width=buffer.get_width();
+ height=buffer.get_height();
+ if ((target_width>0)&&(target_height>0))
+ {
+  width=target_width;
+  height=target_height;
+ }
+ length=static_cast<size_t>(width)*static_cast<size_t>(height);
+ this->clear_buffer();
+ current_palette=palette;
+ if (buffer.get_type()==INDEXED_IMAGE)
+ {
+  indexes=this->create_index_buffer(width,height);
+  if (pcx==true) buffer.load_pcx(name,indexes,palette,length,width,height); else buffer.load_tga(name,indexes,palette,length,width,height);
+ }
+ else
+ {
+  pixels=this->create_native_buffer(width,height);
+  if (pcx==true) buffer.load_pcx(name,pixels,length,width,height); else buffer.load_tga(name,pixels,length,width,height);
+ }
+
+}
+
+IMG_Pixel *Surface::create_buffer(const unsigned long int image_width,const unsigned long int image_height)
+{
+ IMG_Pixel *result;
+ size_t length;
+ length=static_cast<size_t>(image_width)*static_cast<size_t>(image_height);
+ result=reinterpret_cast<IMG_Pixel*>(calloc(length,3));
+ if (result==NULL)
+ {
+  Halt("Can't allocate memory for image buffer");
+ }
+ return result;
+}
+
+unsigned char *Surface::create_index_buffer(const unsigned long int image_width,const unsigned long int image_height)
+{
+ unsigned char *result;
+ size_t length;
+ length=static_cast<size_t>(image_width)*static_cast<size_t>(image_height);
+ result=static_cast<unsigned char*>(calloc(length,1));
+ if (result==NULL)
+ {
+  Halt("Can't allocate memory for image buffer");
+ }
+ return result;
+}
+
+unsigned short int *Surface::create_native_buffer(const unsigned long int image_width,const unsigned long int image_height)
+{
+ unsigned short int *result;
+ size_t length;
+ length=static_cast<size_t>(image_width)*static_cast<size_t>(image_height);
+ result=static_cast<unsigned short int*>(calloc(length,sizeof(unsigned short int)));
+ if (result==NULL)
+ {
+  Halt("Can't allocate memory for image buffer");
+ }
+ return result;
+}
+
+void Surface::save()
+{
+ surface->save();
+}
+
+void Surface::restore()
+{
+ surface->restore();
+}
+
+void Surface::restore(const unsigned long int x,const unsigned long int y,const unsigned long int width,const unsigned long int height)
+{
+ surface->restore(x,y,width,height);
+}
+
+void Surface::clear_buffer()
+{
+ if (image!=NULL)
+ {
+  free(image);
+  image=NULL;
+ }
+ if (indexes!=NULL)
+ {
+  free(indexes);
+  indexes=NULL;
+ }
+ this->free_native();
+ ++revision;
+}
+
+void Surface::set_size(const unsigned long int image_width,const unsigned long int image_height)
+{
+ width=image_width;
+ height=image_height;
+}
+
+void Surface::set_buffer(IMG_Pixel *buffer)
+{
+ image=buffer;
+ ++revision;
+}
+
+void Surface::set_native_buffer(unsigned short int *buffer)
+{
+ pixels=buffer;
+ borrowed=false;
+ ++revision;
+}
+
+void Surface::set_index_buffer(unsigned char *buffer,const unsigned short int *colors)
+{
+ indexes=buffer;
+ ++revision;
+ memcpy(palette,colors,sizeof(palette));
+ current_palette=palette;
+}
+
+const Pack_Entry *Surface::attach_asset(Asset_Pack &pack,const char *name)
+{
+ const Pack_Entry *asset;
+ asset=pack.get_asset(name);
+ this->clear_buffer();
+ width=asset->width;
+ height=asset->height;
+ current_palette=palette;
+ pixels=pack.get_pixels(asset);
+ borrowed=true;
+ return asset;
+}
+
+size_t Surface::get_offset(const unsigned long int start,const unsigned long int x,const unsigned long int y,const unsigned long int target_width)
+{
+ return static_cast<size_t>(start)+static_cast<size_t>(x)+static_cast<size_t>(y)*static_cast<size_t>(target_width);
+}
+
+size_t Surface::get_offset(const unsigned long int start,const unsigned long int x,const unsigned long int y) const
+{
+ return static_cast<size_t>(start)+static_cast<size_t>(x)+static_cast<size_t>(y)*static_cast<size_t>(width);
+}
+
+void Surface::draw_image_pixel(const size_t offset,const unsigned long int x,const unsigned long int y)
+{
+ if (indexes!=NULL)
+ {
+  if (surface->is_indexed()==true)
+  {
+   surface->draw_index(x,y,indexes[offset]);
+  }
+  else
+  {
+   surface->draw_native_pixel(x,y,current_palette[indexes[offset]]);
+  }
+
+ }
+ if (pixels!=NULL)
+ {
+  surface->draw_native_pixel(x,y,pixels[offset]);
+ }
+ if (image!=NULL)
+ {
+  surface->draw_pixel(x,y,image[offset].red,image[offset].green,image[offset].blue);
+ }
+
+}
+
+bool Surface::compare_pixels(const size_t first,const size_t second) const
+{
+ bool result;
+ result=false;
+ if (indexes!=NULL)
+ {
+  result=indexes[first]!=indexes[second];
+  goto finish;
+ }
+ if (pixels!=NULL)
+ {
+  result=pixels[first]!=pixels[second];
+  goto finish;
+ }
+ if (image[first].red!=image[second].red)
+ {
+  result=true;
+  goto finish;
+ }
+ if (image[first].green!=image[second].green)
+ {
+  result=true;
+  goto finish;
+ }
+ if (image[first].blue!=image[second].blue)
+ {
+  result=true;
+  goto finish;
+ }
+ finish: ;
+ return result;
+}
+
+unsigned short int Surface::get_native_pixel(const size_t offset) const
+{
+ unsigned short int pixel;
+ if (indexes!=NULL)
+ {
+  pixel=current_palette[indexes[offset]];
+ }
+ else if (pixels!=NULL)
+ {
+  pixel=pixels[offset];
+ }
+ else
+ {
+  pixel=surface->pack_pixel(image[offset].red,image[offset].green,image[offset].blue);
+ }
+ return pixel;
+}
+
+unsigned short int *Surface::get_surface_buffer()
+{
+ return surface->get_buffer();
+}
+
+unsigned char *Surface::get_surface_indexes()
+{
+ return surface->get_indexes();
+}
+
+bool Surface::check_key(const unsigned char pixel,const unsigned char key) const
+{
+ return pixel==key;
+}
+
+bool Surface::check_key(const unsigned short int pixel,const unsigned short int key) const
+{
+ return pixel==key;
+}
+
+bool Surface::check_key(const IMG_Pixel &pixel,const IMG_Pixel &key) const
+{
+ return (pixel.red==key.red)&&(pixel.green==key.green)&&(pixel.blue==key.blue);
+}
+
+void Surface::convert_pixel(unsigned short int &target,const unsigned char pixel) const
+{
+ target=current_palette[pixel];
+}
+
+void Surface::convert_pixel(unsigned short int &target,const unsigned short int pixel) const
+{
+ target=pixel;
+}
+
+void Surface::convert_pixel(unsigned short int &target,const IMG_Pixel &pixel) const
+{
+ target=surface->pack_pixel(pixel.red,pixel.green,pixel.blue);
+}
+
+void Surface::convert_pixel(unsigned char &target,const unsigned char pixel) const
+{
+ target=pixel;
+}
+
+void Surface::convert_pixel(unsigned char &target,const unsigned short int pixel) const
+{
+ target=surface->find_index((pixel >> 11) << 3,((pixel >> 5)&63) << 2,(pixel&31) << 3);
+}
+
+void Surface::convert_pixel(unsigned char &target,const IMG_Pixel &pixel) const
+{
+ target=surface->find_index(pixel.red,pixel.green,pixel.blue);
+}
+
+bool Surface::check_indexed() const
+{
+ return surface->is_indexed();
+}
+
+unsigned long int Surface::get_revision() const
+{
+ return revision;
+}
+
+unsigned long int Surface::get_surface_width() const
+{
+ return surface->get_frame_width();
+}
+
+unsigned long int Surface::get_surface_height() const
+{
+ return surface->get_frame_height();
+}
+
+void Surface::initialize(Frame *target)
+{
+ surface=target;
+}
+
+Frame* Surface::get_surface()
+{
+ return surface;
+}
+
+size_t Surface::get_length() const
+{
+ size_t length;
+ length=static_cast<size_t>(width)*static_cast<size_t>(height);
+ if (pixels!=NULL) length*=sizeof(unsigned short int);
+ if (image!=NULL) length*=3;
+ return length;
+}
+
+IMG_Pixel *Surface::get_image()
+{
+ return image;
+}
+
+unsigned char *Surface::get_indexes()
+{
+ return indexes;
+}
+
+unsigned short int *Surface::get_pixels()
+{
+ return pixels;
+}
+
+unsigned short int *Surface::get_palette()
+{
+ return palette;
+}
+
+bool Surface::is_indexed() const
+{
+ return indexes!=NULL;
+}
+
+bool Surface::is_native() const
+{
+ return pixels!=NULL;
+}
+
+void Surface::set_palette(const unsigned short int *colors)
+{
+ current_palette=palette;
+ if (colors!=NULL) current_palette=colors;
+}
+
+void Surface::load_image(Image &buffer)
+{
+ size_t index;
+ unsigned char *colors;
+ width=buffer.get_width();
+ height=buffer.get_height();
+ this->clear_buffer();
+ if (buffer.get_type()==INDEXED_IMAGE)
+ {
+  colors=buffer.get_palette();
+  for (index=0;index<256;++index)
+  {
+   palette[index]=(colors[index*3] >> 3)+((colors[index*3+1] >> 2) << 5)+((colors[index*3+2] >> 3) << 11); // This code bases on code from SVGALib
+  }
+  current_palette=palette;
+  indexes=this->create_index_buffer(width,height);
+  memmove(indexes,buffer.get_data(),buffer.get_length());
+ }
+ else
+ {
+  image=this->create_buffer(width,height);
+  memmove(image,buffer.get_data(),buffer.get_length());
+ }
+
+}
+
+void Surface::load_tga(const char *name)
+{
+ this->load_file(name,false,0,0);
+}
+
+void Surface::load_pcx(const char *name)
+{
+ this->load_file(name,true,0,0);
+}
+
+void Surface::load_tga(const char *name,const unsigned long int target_width,const unsigned long int target_height)
+{
+ this->load_file(name,false,target_width,target_height);
+}
+
+void Surface::load_pcx(const char *name,const unsigned long int target_width,const unsigned long int target_height)
+{
+ this->load_file(name,true,target_width,target_height);
+}
+
+void Surface::load_asset(Asset_Pack &pack,const char *name)
+{
+ this->attach_asset(pack,name);
+}
+
+void Surface::swap_image(Surface &source)
+{
+ IMG_Pixel *target_image;
+ unsigned char *target_indexes;
+ unsigned short int *target_pixels;
+ const unsigned short int *target_palette;
+ unsigned short int colors[256];
+ unsigned long int value;
+ bool state;
+ target_image=image;
+ image=source.image;
+ source.image=target_image;
+ target_indexes=indexes;
+ indexes=source.indexes;
+ source.indexes=target_indexes;
+ target_pixels=pixels;
+ pixels=source.pixels;
+ source.pixels=target_pixels;
+ value=width;
+ width=source.width;
+ source.width=value;
+ value=height;
+ height=source.height;
+ source.height=value;
+ state=borrowed;
+ borrowed=source.borrowed;
+ source.borrowed=state;
+ memcpy(colors,palette,sizeof(palette));
+ memcpy(palette,source.palette,sizeof(palette));
+ memcpy(source.palette,colors,sizeof(palette));
+ target_palette=current_palette;
+ current_palette=source.current_palette;
+ source.current_palette=target_palette;
+ if (current_palette==source.palette) current_palette=palette;
+ if (source.current_palette==palette) source.current_palette=source.palette;
+ ++revision;
+ ++source.revision;
+}
+
+unsigned long int Surface::get_image_width() const
+{
+ return width;
+}
+
+unsigned long int Surface::get_image_height() const
+{
+ return height;
+}
+
+void Surface::mirror_image(const MIRROR_TYPE kind)
+{
+ unsigned long int x,y,index;
+ IMG_Pixel *mirrored_image;
+ unsigned char *mirrored_indexes;
+ unsigned short int *mirrored_pixels;
+ x=0;
+ y=0;
+ mirrored_image=NULL;
+ mirrored_indexes=NULL;
+ mirrored_pixels=NULL;
+ if (indexes!=NULL) mirrored_indexes=this->create_index_buffer(width,height);
+ if (pixels!=NULL) mirrored_pixels=this->create_native_buffer(width,height);
+ if (image!=NULL) mirrored_image=this->create_buffer(width,height);
+ if (kind==MIRROR_HORIZONTAL)
+ {
+  for (index=width*height;index>0;--index)
+  {
+   this->copy_pixel(mirrored_image,mirrored_indexes,mirrored_pixels,this->get_offset(0,x,y),this->get_offset(0,(width-x-1),y));
+   ++x;
+   if (x==width)
+   {
+    x=0;
+    ++y;
+   }
+
+  }
+
+ }
+ if (kind==MIRROR_VERTICAL)
+ {
+  for (index=width*height;index>0;--index )
+  {
+   this->copy_pixel(mirrored_image,mirrored_indexes,mirrored_pixels,this->get_offset(0,x,y),this->get_offset(0,x,(height-y-1)));
+   ++x;
+   if (x==width)
+   {
+    x=0;
+    ++y;
+   }
+
+  }
+
+ }
+ this->replace_buffer(mirrored_image,mirrored_indexes,mirrored_pixels);
+}
+
+void Surface::resize_image(const unsigned long int new_width,const unsigned long int new_height)
+{
+ float x_ratio,y_ratio;
+ unsigned long int x,y,steps;
+ size_t index,location,position;
+ IMG_Pixel *scaled_image;
+ unsigned char *scaled_indexes;
+ unsigned short int *scaled_pixels;
+ x=0;
+ y=0;
+ steps=new_width*new_height;
+ scaled_image=NULL;
+ scaled_indexes=NULL;
+ scaled_pixels=NULL;
+ if (indexes!=NULL) scaled_indexes=this->create_index_buffer(new_width,new_height);
+ if (pixels!=NULL) scaled_pixels=this->create_native_buffer(new_width,new_height);
+ if (image!=NULL) scaled_image=this->create_buffer(new_width,new_height);
+ x_ratio=static_cast<float>(width)/static_cast<float>(new_width);
+ y_ratio=static_cast<float>(height)/static_cast<float>(new_height);
+ for (index=0;index<steps;++index)
+ {
+  location=this->get_offset(0,x,y,new_width);
+  position=this->get_offset(0,(x_ratio*static_cast<float>(x)),(y_ratio*static_cast<float>(y)),width);
+  this->copy_pixel(scaled_image,scaled_indexes,scaled_pixels,location,position);
+  ++x;
+  if (x==new_width)
+  {
+   x=0;
+   ++y;
+  }
+
+ }
+ this->replace_buffer(scaled_image,scaled_indexes,scaled_pixels);
+ width=new_width;
+ height=new_height;
+}
+
+void Surface::horizontal_mirror()
+{
+ this->mirror_image(MIRROR_HORIZONTAL);
+}
+
+void Surface::vertical_mirror()
+{
+ this->mirror_image(MIRROR_VERTICAL);
+}
+
+Animation::Animation()
+{
+ start=0;
+ frame=1;
+ frames=1;
+}
+
+Animation::~Animation()
+{
+
+}
+
+void Animation::set_frame(const unsigned long int target)
+{
+ if (target>0)
+ {
+  if (target<=frames) frame=target;
+ }
+
+}
+
+void Animation::increase_frame()
+{
+ ++frame;
+ if (frame>frames)
+ {
+  frame=1;
+ }
+
+}
+
+void Animation::set_frames(const unsigned long int amount)
+{
+ if (amount>1) frames=amount;
+}
+
+unsigned long int Animation::get_frames() const
+{
+ return frames;
+}
+
+unsigned long int Animation::get_frame() const
+{
+ return frame;
+}
+
+Background::Background()
+{
+ background_width=0;
+ background_height=0;
+ maximum_width=0;
+ maximum_height=0;
+ current=0;
+ current_kind=NORMAL_BACKGROUND;
+}
+
+Background::~Background()
+{
+
+}
+
+void Background::get_maximum_width()
+{
+ maximum_width=background_width;
+ if (maximum_width>this->get_surface_width())
+ {
+  maximum_width=this->get_surface_width();
+ }
+
+}
+
+void Background::get_maximum_height()
+{
+ maximum_height=background_height;
+ if (maximum_height>this->get_surface_height())
+ {
+  maximum_height=this->get_surface_height();
+ }
+
+}
+
+void Background::slow_draw_background()
+{
+ unsigned long int x,y,index;
+ x=0;
+ y=0;
+ for (index=maximum_width*maximum_height;index>0;--index)
+ {
+  this->draw_image_pixel(this->get_offset(start,x,y),x,y);
+  ++x;
+  if (x==maximum_width)
+  {
+   x=0;
+   ++y;
+  }
+
+ }
+
+}
+
+void Background::configure_background()
+{
+ switch(current_kind)
+ {
+  case NORMAL_BACKGROUND:
+  background_width=this->get_image_width();
+  background_height=this->get_image_height();
+  start=0;
+  break;
+  case HORIZONTAL_BACKGROUND:
+  background_width=this->get_image_width()/this->get_frames();
+  background_height=this->get_image_height();
+  start=(this->get_frame()-1)*background_width;
+  break;
+  case VERTICAL_BACKGROUND:
+  background_width=this->get_image_width();
+  background_height=this->get_image_height()/this->get_frames();
+  start=(this->get_frame()-1)*background_width*background_height;
+  break;
+ }
+
+}
+
+long int Background::wrap_coordinate(const long int value,const long int limit) const
+{
+ long int result;
+ result=value%limit;
+ if (result<0) result+=limit;
+ return result;
+}
+
+void Background::check_affine_size() const
+{
+ if ((background_width>static_cast<unsigned long int>(LONG_MAX/FIXED_ONE))||(background_height>static_cast<unsigned long int>(LONG_MAX/FIXED_ONE)))
+ {
+  Halt("The background is too big for the affine drawing");
+ }
+
+}
+
+template <typename source_type,typename target_type>
+void Background::fill_affine_line(target_type *target,const source_type *source,const Affine_Line &setting)
+{
+ long int x,y,step_x,step_y,limit_x,limit_y;
+ unsigned long int index,width;
+ size_t image_width;
+ width=this->get_surface_width();
+ image_width=this->get_image_width();
+ limit_x=static_cast<long int>(background_width)*FIXED_ONE;
+ limit_y=static_cast<long int>(background_height)*FIXED_ONE;
+ x=this->wrap_coordinate(setting.x,limit_x);
+ y=this->wrap_coordinate(setting.y,limit_y);
+ step_x=setting.dx%limit_x;
+ step_y=setting.dy%limit_y;
+ source+=start;
+ for (index=0;index<width;++index)
+ {
+  this->convert_pixel(target[index],source[static_cast<size_t>(x >> FIXED_SHIFT)+static_cast<size_t>(y >> FIXED_SHIFT)*image_width]);
+  x+=step_x;
+  y+=step_y;
+  if (x>=limit_x) x-=limit_x;
+  if (x<0) x+=limit_x;
+  if (y>=limit_y) y-=limit_y;
+  if (y<0) y+=limit_y;
+ }
+
+}
+
+void Background::draw_affine_line(const unsigned long int line,const Affine_Line &setting)
+{
+ size_t position;
+ position=this->get_offset(0,0,line,this->get_surface_width());
+ if (this->check_indexed()==true)
+ {
+  if (this->get_indexes()!=NULL)
+  {
+   this->fill_affine_line(this->get_surface_indexes()+position,this->get_indexes(),setting);
+  }
+  else if (this->get_pixels()!=NULL)
+  {
+   this->fill_affine_line(this->get_surface_indexes()+position,this->get_pixels(),setting);
+  }
+  else
+  {
+   this->fill_affine_line(this->get_surface_indexes()+position,this->get_image(),setting);
+  }
+
+ }
+ else
+ {
+  if (this->get_indexes()!=NULL)
+  {
+   this->fill_affine_line(this->get_surface_buffer()+position,this->get_indexes(),setting);
+  }
+  else if (this->get_pixels()!=NULL)
+  {
+   this->fill_affine_line(this->get_surface_buffer()+position,this->get_pixels(),setting);
+  }
+  else
+  {
+   this->fill_affine_line(this->get_surface_buffer()+position,this->get_image(),setting);
+  }
+
+ }
+
+}
+
+unsigned long int Background::get_width() const
+{
+ return background_width;
+}
+
+unsigned long int Background::get_height() const
+{
+ return background_height;
+}
+
+void Background::set_kind(const BACKGROUND_TYPE kind)
+{
+ current_kind=kind;
+ this->configure_background();
+ this->get_maximum_width();
+ this->get_maximum_height();
+}
+
+void Background::set_setting(const BACKGROUND_TYPE kind,const unsigned long int frames)
+{
+ if (kind!=NORMAL_BACKGROUND) this->set_frames(frames);
+ this->set_kind(kind);
+}
+
+void Background::set_target(const unsigned long int target)
+{
+ this->set_frame(target);
+ this->set_kind(current_kind);
+}
+
+void Background::step()
+{
+ this->increase_frame();
+ this->set_kind(current_kind);
+}
+
+void Background::draw_background()
+{
+ if (current!=this->get_frame())
+ {
+  this->slow_draw_background();
+  this->save();
+  current=this->get_frame();
+ }
+ else
+ {
+  this->restore();
+ }
+
+}
+
+void Background::draw_affine_background(const Affine_Line *lines)
+{
+ unsigned long int line,height;
+ height=this->get_surface_height();
+ if ((background_width>0)&&(background_height>0))
+ {
+  this->check_affine_size();
+  for (line=0;line<height;++line)
+  {
+   this->draw_affine_line(line,lines[line]);
+  }
+
+ }
+
+}
+
+void Background::draw_affine_background(AFFINE_CALLBACK callback,void *data)
+{
+ unsigned long int line,height;
+ Affine_Line setting;
+ height=this->get_surface_height();
+ if ((background_width>0)&&(background_height>0))
+ {
+  this->check_affine_size();
+  for (line=0;line<height;++line)
+  {
+   setting.x=0;
+   setting.y=0;
+   setting.dx=FIXED_ONE;
+   setting.dy=0;
+   callback(line,setting,data);
+   this->draw_affine_line(line,setting);
+  }
+
+ }
+
+}
+
+void Background::copy_frame(unsigned short int *target) const
+{
+ unsigned long int x,y;
+ size_t position;
+ position=0;
+ for (y=0;y<background_height;++y)
+ {
+  for (x=0;x<background_width;++x)
+  {
+   target[position]=this->get_native_pixel(this->get_offset(start,x,y));
+   ++position;
+  }
+
+ }
+
+}
+
+void Background::load_background(Asset_Pack &pack,const char *name)
+{
+ const Pack_Entry *asset;
+ asset=this->attach_asset(pack,name);
+ if (asset->kind==BACKGROUND_ASSET)
+ {
+  this->set_setting(static_cast<BACKGROUND_TYPE>(asset->setting),asset->frames);
+ }
+ else
+ {
+  this->set_kind(NORMAL_BACKGROUND);
+ }
+
+}
+
+Sprite::Sprite()
+{
+ transparent=true;
+ horizontal_flip=false;
+ vertical_flip=false;
+ drawn=false;
+ drawn_box.x=0;
+ drawn_box.y=0;
+ drawn_box.width=0;
+ drawn_box.height=0;
+ current_x=0;
+ current_y=0;
+ sprite_width=0;
+ sprite_height=0;
+ current_kind=SINGLE_SPRITE;
+ bounds=NULL;
+ bounds_amount=0;
+ bounds_width=0;
+ bounds_height=0;
+ bounds_revision=0;
+ bounds_kind=SINGLE_SPRITE;
+}
+
+Sprite::~Sprite()
+{
+ this->clear_bounds();
+}
+
+void Sprite::clear_bounds()
+{
+ if (bounds!=NULL)
+ {
+  delete[] bounds;
+  bounds=NULL;
+ }
+ bounds_amount=0;
+}
+
+size_t Sprite::get_frame_start(const unsigned long int target) const
+{
+ size_t frame_start;
+ frame_start=0;
+ if (current_kind==HORIZONTAL_STRIP)
+ {
+  frame_start=static_cast<size_t>(target)*static_cast<size_t>(sprite_width);
+ }
+ if (current_kind==VERTICAL_STRIP)
+ {
+  frame_start=static_cast<size_t>(target)*static_cast<size_t>(sprite_width)*static_cast<size_t>(sprite_height);
+ }
+ return frame_start;
+}
+
+Collision_Box Sprite::calculate_bound(const size_t frame_start) const
+{
+ unsigned long int x,y,stop_x,stop_y;
+ Collision_Box target;
+ target.x=sprite_width;
+ target.y=sprite_height;
+ stop_x=0;
+ stop_y=0;
+ for (y=0;y<sprite_height;++y)
+ {
+  for (x=0;x<sprite_width;++x)
+  {
+   if (this->compare_pixels(0,this->get_offset(frame_start,x,y))==true)
+   {
+    if (x<target.x) target.x=x;
+    if (y<target.y) target.y=y;
+    if (x>=stop_x) stop_x=x+1;
+    if (y>=stop_y) stop_y=y+1;
+   }
+
+  }
+
+ }
+ if (stop_x==0)
+ {
+  target.x=0;
+  target.y=0;
+  target.width=0;
+  target.height=0;
+ }
+ else
+ {
+  target.width=stop_x-target.x;
+  target.height=stop_y-target.y;
+ }
+ return target;
+}
+
+void Sprite::calculate_bounds()
+{
+ unsigned long int index;
+ this->clear_bounds();
+ bounds_amount=1;
+ if (current_kind!=SINGLE_SPRITE) bounds_amount=this->get_frames();
+ try
+ {
+  bounds=new Collision_Box[bounds_amount];
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for sprite bounds");
+ }
+ for (index=0;index<bounds_amount;++index)
+ {
+  bounds[index]=this->calculate_bound(this->get_frame_start(index));
+ }
+ bounds_width=sprite_width;
+ bounds_height=sprite_height;
+ bounds_kind=current_kind;
+ bounds_revision=this->get_revision();
+}
+
+void Sprite::check_bounds()
+{
+ bool changed;
+ changed=(bounds==NULL)||(bounds_revision!=this->get_revision())||(bounds_kind!=current_kind);
+ if ((bounds_width!=sprite_width)||(bounds_height!=sprite_height)) changed=true;
+ if ((current_kind!=SINGLE_SPRITE)&&(bounds_amount!=this->get_frames())) changed=true;
+ if (changed==true) this->calculate_bounds();
+}
+
+Collision_Box Sprite::get_bound()
+{
+ unsigned long int index;
+ index=0;
+ this->check_bounds();
+ if (current_kind!=SINGLE_SPRITE) index=this->get_frame()-1;
+ return bounds[index];
+}
+
+Collision_Box Sprite::get_placement(const Collision_Box &bound) const
+{
+ Collision_Box target;
+ target=bound;
+ if (horizontal_flip==true) target.x=sprite_width-bound.x-bound.width;
+ if (vertical_flip==true) target.y=sprite_height-bound.y-bound.height;
+ target.x+=current_x;
+ target.y+=current_y;
+ return target;
+}
+
+void Sprite::remember_box(const Collision_Box &bound)
+{
+ drawn_box=this->get_placement(bound);
+ drawn=false;
+ if ((drawn_box.x<this->get_surface_width())&&(drawn_box.y<this->get_surface_height()))
+ {
+  if (drawn_box.width>this->get_surface_width()-drawn_box.x) drawn_box.width=this->get_surface_width()-drawn_box.x;
+  if (drawn_box.height>this->get_surface_height()-drawn_box.y) drawn_box.height=this->get_surface_height()-drawn_box.y;
+  drawn=(drawn_box.width>0)&&(drawn_box.height>0);
+ }
+
+}
+
+template <bool transparency,bool horizontal,bool vertical,typename source_type,typename target_type>
+void Sprite::copy_rows(target_type *target,const source_type *source,const Collision_Box &bound,const unsigned long int stop_x,const unsigned long int stop_y)
+{
+ unsigned long int x,y,source_x,source_y,frame_width;
+ const source_type *pixel;
+ frame_width=this->get_surface_width();
+ source_x=bound.x;
+ if (horizontal==true) source_x=bound.x+bound.width-1;
+ for (y=0;y<stop_y;++y)
+ {
+  source_y=bound.y+y;
+  if (vertical==true) source_y=bound.y+bound.height-1-y;
+  pixel=source+this->get_offset(start,source_x,source_y);
+  for (x=0;x<stop_x;++x)
+  {
+   if ((transparency==false)||(this->check_key(*pixel,source[0])==false)) this->convert_pixel(target[x],*pixel);
+   if (horizontal==true) --pixel; else ++pixel;
+  }
+  target+=frame_width;
+ }
+
+}
+
+template <bool transparency,bool horizontal,bool vertical,typename target_type>
+void Sprite::select_source(target_type *target,const Collision_Box &bound,const unsigned long int stop_x,const unsigned long int stop_y)
+{
+ if (this->get_indexes()!=NULL)
+ {
+  this->copy_rows<transparency,horizontal,vertical>(target,this->get_indexes(),bound,stop_x,stop_y);
+ }
+ else if (this->get_pixels()!=NULL)
+ {
+  this->copy_rows<transparency,horizontal,vertical>(target,this->get_pixels(),bound,stop_x,stop_y);
+ }
+ else
+ {
+  this->copy_rows<transparency,horizontal,vertical>(target,this->get_image(),bound,stop_x,stop_y);
+ }
+
+}
+
+template <bool transparency,bool horizontal,bool vertical,bool clipping>
+void Sprite::draw_frame(const Collision_Box &bound)
+{
+ unsigned long int stop_x,stop_y,frame_width;
+ size_t position;
+ Collision_Box placement;
+ placement=this->get_placement(bound);
+ frame_width=this->get_surface_width();
+ stop_x=placement.width;
+ stop_y=placement.height;
+ if (clipping==true)
+ {
+  stop_x=0;
+  stop_y=0;
+  if (placement.x<frame_width) stop_x=frame_width-placement.x;
+  if (placement.y<this->get_surface_height()) stop_y=this->get_surface_height()-placement.y;
+  if (stop_x>placement.width) stop_x=placement.width;
+  if (stop_y>placement.height) stop_y=placement.height;
+ }
+ if ((stop_x>0)&&(stop_y>0))
+ {
+  position=this->get_offset(0,placement.x,placement.y,frame_width);
+  if (this->check_indexed()==true)
+  {
+   this->select_source<transparency,horizontal,vertical>(this->get_surface_indexes()+position,bound,stop_x,stop_y);
+  }
+  else
+  {
+   this->select_source<transparency,horizontal,vertical>(this->get_surface_buffer()+position,bound,stop_x,stop_y);
+  }
+
+ }
+
+}
+
+template <bool transparency,bool horizontal,bool vertical>
+void Sprite::select_clipping(const Collision_Box &bound)
+{
+ Collision_Box placement;
+ unsigned long int surface_width,surface_height;
+ placement=this->get_placement(bound);
+ surface_width=this->get_surface_width();
+ surface_height=this->get_surface_height();
+ if ((placement.x<surface_width)&&(placement.width<=surface_width-placement.x)&&(placement.y<surface_height)&&(placement.height<=surface_height-placement.y))
+ {
+  this->draw_frame<transparency,horizontal,vertical,false>(bound);
+ }
+ else
+ {
+  this->draw_frame<transparency,horizontal,vertical,true>(bound);
+ }
+
+}
+
+template <bool transparency,bool horizontal>
+void Sprite::select_vertical(const Collision_Box &bound)
+{
+ if (vertical_flip==true)
+ {
+  this->select_clipping<transparency,horizontal,true>(bound);
+ }
+ else
+ {
+  this->select_clipping<transparency,horizontal,false>(bound);
+ }
+
+}
+
+template <bool transparency>
+void Sprite::select_horizontal(const Collision_Box &bound)
+{
+ if (horizontal_flip==true)
+ {
+  this->select_vertical<transparency,true>(bound);
+ }
+ else
+ {
+  this->select_vertical<transparency,false>(bound);
+ }
+
+}
+
+void Sprite::load_sprite(Image &buffer,const SPRITE_TYPE kind,const unsigned long int frames)
+{
+ this->load_image(buffer);
+ if (kind!=SINGLE_SPRITE) this->set_frames(frames);
+ this->set_kind(kind);
+ this->calculate_bounds();
+}
+
+void Sprite::load_sprite(Asset_Pack &pack,const char *name)
+{
+ const Pack_Entry *asset;
+ SPRITE_TYPE kind;
+ asset=this->attach_asset(pack,name);
+ kind=SINGLE_SPRITE;
+ if (asset->kind==SPRITE_ASSET) kind=static_cast<SPRITE_TYPE>(asset->setting);
+ if (kind!=SINGLE_SPRITE) this->set_frames(asset->frames);
+ this->set_kind(kind);
+ this->calculate_bounds();
+}
+
+void Sprite::set_transparent(const bool enabled)
+{
+ transparent=enabled;
+}
+
+bool Sprite::get_transparent() const
+{
+ return transparent;
+}
+
+void Sprite::set_flip(const bool horizontal,const bool vertical)
+{
+ horizontal_flip=horizontal;
+ vertical_flip=vertical;
+}
+
+bool Sprite::get_horizontal_flip() const
+{
+ return horizontal_flip;
+}
+
+bool Sprite::get_vertical_flip() const
+{
+ return vertical_flip;
+}
+
+void Sprite::set_x(const unsigned long int x)
+{
+ current_x=x;
+}
+
+void Sprite::set_y(const unsigned long int y)
+{
+ current_y=y;
+}
+
+void Sprite::increase_x()
+{
+ ++current_x;
+}
+
+void Sprite::decrease_x()
+{
+ --current_x;
+}
+
+void Sprite::increase_y()
+{
+ ++current_y;
+}
+
+void Sprite::decrease_y()
+{
+ --current_y;
+}
+
+void Sprite::increase_x(const unsigned long int increment)
+{
+ current_x+=increment;
+}
+
+void Sprite::decrease_x(const unsigned long int decrement)
+{
+ current_x-=decrement;
+}
+
+void Sprite::increase_y(const unsigned long int increment)
+{
+ current_y+=increment;
+}
+
+void Sprite::decrease_y(const unsigned long int decrement)
+{
+ current_y-=decrement;
+}
+
+unsigned long int Sprite::get_x() const
+{
+ return current_x;
+}
+
+unsigned long int Sprite::get_y() const
+{
+ return current_y;
+}
+
+unsigned long int Sprite::get_width() const
+{
+ return sprite_width;
+}
+
+unsigned long int Sprite::get_height() const
+{
+ return sprite_height;
+}
+
+Sprite* Sprite::get_handle()
+{
+ return this;
+}
+
+Collision_Box Sprite::get_box() const
+{
+ Collision_Box target;
+ target.x=current_x;
+ target.y=current_y;
+ target.width=sprite_width;
+ target.height=sprite_height;
+ return target;
+}
+
+Collision_Box Sprite::get_trimmed_box()
+{
+ return this->get_placement(this->get_bound());
+}
+
+void Sprite::copy_frame(const unsigned long int target,unsigned short int *pixels,bool *opaque)
+{
+ unsigned long int x,y;
+ size_t frame_start,position,index;
+ if ((target>0)&&(target<=this->get_frames()))
+ {
+  frame_start=this->get_frame_start(target-1);
+  index=0;
+  for (y=0;y<sprite_height;++y)
+  {
+   for (x=0;x<sprite_width;++x)
+   {
+    position=this->get_offset(frame_start,x,y);
+    pixels[index]=this->get_native_pixel(position);
+    opaque[index]=this->compare_pixels(0,position);
+    ++index;
+   }
+
+  }
+
+ }
+
+}
+
+Collision_Box Sprite::get_drawn_box() const
+{
+ return drawn_box;
+}
+
+bool Sprite::is_drawn() const
+{
+ return drawn;
+}
+
+void Sprite::erase()
+{
+ if (drawn==true)
+ {
+  this->restore(drawn_box.x,drawn_box.y,drawn_box.width,drawn_box.height);
+  drawn=false;
+ }
+
+}
+
+void Sprite::set_kind(const SPRITE_TYPE kind)
+{
+ switch(kind)
+ {
+  case SINGLE_SPRITE:
+  sprite_width=this->get_image_width();
+  sprite_height=this->get_image_height();
+  start=0;
+  break;
+  case HORIZONTAL_STRIP:
+  sprite_width=this->get_image_width()/this->get_frames();
+  sprite_height=this->get_image_height();
+  start=(this->get_frame()-1)*sprite_width;
+  break;
+  case VERTICAL_STRIP:
+  sprite_width=this->get_image_width();
+  sprite_height=this->get_image_height()/this->get_frames();
+  start=(this->get_frame()-1)*sprite_width*sprite_height;
+  break;
+ }
+ current_kind=kind;
+}
+
+SPRITE_TYPE Sprite::get_kind() const
+{
+ return current_kind;
+}
+
+void Sprite::set_target(const unsigned long int target)
+{
+ this->set_frame(target);
+ this->set_kind(current_kind);
+}
+
+void Sprite::step()
+{
+ this->increase_frame();
+ this->set_kind(current_kind);
+}
+
+void Sprite::set_position(const unsigned long int x,const unsigned long int y)
+{
+ current_x=x;
+ current_y=y;
+}
+
+void Sprite::clone(Sprite &target)
+{
+ this->set_size(target.get_image_width(),target.get_image_height());
+ this->set_frames(target.get_frames());
+ this->set_kind(target.get_kind());
+ this->set_transparent(target.get_transparent());
+ this->set_flip(target.get_horizontal_flip(),target.get_vertical_flip());
+ this->clear_buffer();
+ if (target.is_indexed()==true)
+ {
+  this->set_index_buffer(this->create_index_buffer(target.get_image_width(),target.get_image_height()),target.get_palette());
+  memmove(this->get_indexes(),target.get_indexes(),target.get_length());
+ }
+ else if (target.is_native()==true)
+ {
+  this->set_native_buffer(this->create_native_buffer(target.get_image_width(),target.get_image_height()));
+  memmove(this->get_pixels(),target.get_pixels(),target.get_length());
+ }
+ else
+ {
+  this->set_buffer(this->create_buffer(target.get_image_width(),target.get_image_height()));
+  memmove(this->get_image(),target.get_image(),target.get_length());
+ }
+
+}
+
+void Sprite::draw_sprite()
+{
+ Collision_Box bound;
+ if (transparent==true)
+ {
+  bound=this->get_bound();
+  if ((bound.width>0)&&(bound.height>0)) this->select_horizontal<true>(bound);
+ }
+ else
+ {
+  bound.x=0;
+  bound.y=0;
+  bound.width=sprite_width;
+  bound.height=sprite_height;
+  if ((bound.width>0)&&(bound.height>0)) this->select_horizontal<false>(bound);
+ }
+ this->remember_box(bound);
+}
+
+void Sprite::draw_sprite(const unsigned long int x,const unsigned long int y)
+{
+ this->set_position(x,y);
+ this->draw_sprite();
+}
+
+void Sprite::draw_sprite(const bool transparency)
+{
+ this->set_transparent(transparency);
+ this->draw_sprite();
+}
+
+void Sprite::draw_sprite(const bool transparency,const unsigned long int x,const unsigned long int y)
+{
+ this->set_transparent(transparency);
+ this->draw_sprite(x,y);
+}
+
+Tileset::Tileset()
+{
+ offset=0;
+ rows=0;
+ columns=0;
+ tile_width=0;
+ tile_height=0;
+}
+
+Tileset::~Tileset()
+{
+
+}
+
+unsigned long int Tileset::get_tile_width() const
+{
+ return tile_width;
+}
+
+unsigned long int Tileset::get_tile_height() const
+{
+ return tile_height;
+}
+
+unsigned long int Tileset::get_rows() const
+{
+ return rows;
+}
+
+unsigned long int Tileset::get_columns() const
+{
+ return columns;
+}
+
+void Tileset::select_tile(const unsigned long int row,const unsigned long int column)
+{
+ if ((row<rows)&&(column<columns))
+ {
+  offset=this->get_offset(0,row*tile_width,column*tile_height);
+ }
+
+}
+
+void Tileset::draw_tile(const unsigned long int x,const unsigned long int y)
+{
+ unsigned long int tile_x,tile_y,index;
+ tile_x=0;
+ tile_y=0;
+ for (index=tile_width*tile_height;index>0;--index)
+ {
+  this->draw_image_pixel(offset+this->get_offset(0,tile_x,tile_y),x+tile_x,y+tile_y);
+  ++tile_x;
+  if (tile_x==tile_width)
+  {
+   tile_x=0;
+   ++tile_y;
+  }
+
+ }
+
+}
+
+void Tileset::draw_tile(const unsigned long int row,const unsigned long int column,const unsigned long int x,const unsigned long int y)
+{
+ this->select_tile(row,column);
+ this->draw_tile(x,y);
+}
+
+void Tileset::load_tileset(Image &buffer,const unsigned long int row_amount,const unsigned long int column_amount)
+{
+ if ((row_amount>0)&&(column_amount>0))
+ {
+  this->load_image(buffer);
+  rows=row_amount;
+  columns=column_amount;
+  tile_width=this->get_image_width()/rows;
+  tile_height=this->get_image_height()/columns;
+ }
+
+}
+
+void Tileset::load_tileset(Asset_Pack &pack,const char *name)
+{
+ const Pack_Entry *asset;
+ asset=this->attach_asset(pack,name);
+ rows=1;
+ columns=1;
+ if (asset->kind==TILESET_ASSET)
+ {
+  rows=asset->rows;
+  columns=asset->columns;
+ }
+ tile_width=this->get_image_width()/rows;
+ tile_height=this->get_image_height()/columns;
+}
+
+Texture::Texture()
+{
+ transparent=true;
+ u_gradient=0;
+ v_gradient=0;
+ u_step=0;
+ v_step=0;
+}
+
+Texture::~Texture()
+{
+
+}
+
+long int Texture::get_slope(const long int start,const long int stop,const long int length) const
+{
+ long int slope;
+ slope=0;
+ if (length>0)
+ {
+  slope=((stop-start)*FIXED_ONE)/length;
+ }
+ return slope;
+}
+
+bool Texture::calculate_gradients(const Texture_Vertex &first,const Texture_Vertex &second,const Texture_Vertex &third)
+{
+ bool result;
+ float area,first_u,first_v,second_u,second_v,first_y,second_y;
+ result=false;
+ area=static_cast<float>((second.x-first.x)*(third.y-first.y)-(third.x-first.x)*(second.y-first.y));
+ if (area!=0)
+ {
+  first_u=static_cast<float>(second.u)-static_cast<float>(first.u);
+  first_v=static_cast<float>(second.v)-static_cast<float>(first.v);
+  second_u=static_cast<float>(third.u)-static_cast<float>(first.u);
+  second_v=static_cast<float>(third.v)-static_cast<float>(first.v);
+  first_y=static_cast<float>(second.y-first.y);
+  second_y=static_cast<float>(third.y-first.y);
+  u_gradient=(first_u*second_y-second_u*first_y)/area;
+  v_gradient=(first_v*second_y-second_v*first_y)/area;
+  u_step=static_cast<long int>(u_gradient*static_cast<float>(FIXED_ONE));
+  v_step=static_cast<long int>(v_gradient*static_cast<float>(FIXED_ONE));
+  result=true;
+ }
+ return result;
+}
+
+template <bool transparency,typename source_type,typename target_type>
+void Texture::fill_span(target_type *target,const source_type *source,const long int length,const long int u,const long int v)
+{
+ long int x,texture_x,texture_y,texture_u,texture_v,width,height;
+ const source_type *pixel;
+ width=static_cast<long int>(this->get_image_width());
+ height=static_cast<long int>(this->get_image_height());
+ texture_u=u;
+ texture_v=v;
+ for (x=0;x<length;++x)
+ {
+  texture_x=texture_u>>FIXED_SHIFT;
+  texture_y=texture_v>>FIXED_SHIFT;
+  if (texture_x<0) texture_x=0;
+  if (texture_x>=width) texture_x=width-1;
+  if (texture_y<0) texture_y=0;
+  if (texture_y>=height) texture_y=height-1;
+  pixel=source+this->get_offset(0,texture_x,texture_y);
+  if ((transparency==false)||(this->check_key(*pixel,source[0])==false)) this->convert_pixel(target[x],*pixel);
+  texture_u+=u_step;
+  texture_v+=v_step;
+ }
+
+}
+
+template <bool transparency,typename target_type>
+void Texture::select_span(target_type *target,const long int length,const long int u,const long int v)
+{
+ if (this->get_indexes()!=NULL)
+ {
+  this->fill_span<transparency>(target,this->get_indexes(),length,u,v);
+ }
+ else if (this->get_pixels()!=NULL)
+ {
+  this->fill_span<transparency>(target,this->get_pixels(),length,u,v);
+ }
+ else
+ {
+  this->fill_span<transparency>(target,this->get_image(),length,u,v);
+ }
+
+}
+
+void Texture::draw_span(const long int y,const long int long_x,const long int short_x,const long int u,const long int v)
+{
+ long int start,stop,texture_u,texture_v,width;
+ float shift;
+ size_t position;
+ start=long_x;
+ stop=short_x;
+ if (start>stop)
+ {
+  start=short_x;
+  stop=long_x;
+ }
+ start=(start+FIXED_ONE-1)>>FIXED_SHIFT;
+ stop=(stop+FIXED_ONE-1)>>FIXED_SHIFT;
+ width=static_cast<long int>(this->get_surface_width());
+ if (start<0) start=0;
+ if (stop>width) stop=width;
+ if (start<stop)
+ {
+  shift=static_cast<float>(start*FIXED_ONE-long_x)/static_cast<float>(FIXED_ONE);
+  texture_u=u+static_cast<long int>(u_gradient*shift*static_cast<float>(FIXED_ONE));
+  texture_v=v+static_cast<long int>(v_gradient*shift*static_cast<float>(FIXED_ONE));
+  position=this->get_offset(0,start,y,width);
+  if (this->check_indexed()==true)
+  {
+   if (transparent==true)
+   {
+    this->select_span<true>(this->get_surface_indexes()+position,stop-start,texture_u,texture_v);
+   }
+   else
+   {
+    this->select_span<false>(this->get_surface_indexes()+position,stop-start,texture_u,texture_v);
+   }
+
+  }
+  else
+  {
+   if (transparent==true)
+   {
+    this->select_span<true>(this->get_surface_buffer()+position,stop-start,texture_u,texture_v);
+   }
+   else
+   {
+    this->select_span<false>(this->get_surface_buffer()+position,stop-start,texture_u,texture_v);
+   }
+
+  }
+
+ }
+
+}
+
+void Texture::set_transparent(const bool enabled)
+{
+ transparent=enabled;
+}
+
+bool Texture::get_transparent() const
+{
+ return transparent;
+}
+
+Texture* Texture::get_handle()
+{
+ return this;
+}
+
+void Texture::draw_triangle(const Texture_Vertex &first,const Texture_Vertex &second,const Texture_Vertex &third)
+{
+ const Texture_Vertex *top;
+ const Texture_Vertex *middle;
+ const Texture_Vertex *bottom;
+ const Texture_Vertex *swap;
+ long int y,height,long_x,long_u,long_v,long_dx,long_du,long_dv,short_x,short_dx;
+ top=&first;
+ middle=&second;
+ bottom=&third;
+ if (middle->y<top->y)
+ {
+  swap=top;
+  top=middle;
+  middle=swap;
+ }
+ if (bottom->y<middle->y)
+ {
+  swap=middle;
+  middle=bottom;
+  bottom=swap;
+ }
+ if (middle->y<top->y)
+ {
+  swap=top;
+  top=middle;
+  middle=swap;
+ }
+ if (this->get_length()>0)
+ {
+  if (this->calculate_gradients(*top,*middle,*bottom)==true)
+  {
+   height=static_cast<long int>(this->get_surface_height());
+   long_x=top->x*FIXED_ONE;
+   long_u=static_cast<long int>(top->u)*FIXED_ONE;
+   long_v=static_cast<long int>(top->v)*FIXED_ONE;
+   long_dx=this->get_slope(top->x,bottom->x,bottom->y-top->y);
+   long_du=this->get_slope(top->u,bottom->u,bottom->y-top->y);
+   long_dv=this->get_slope(top->v,bottom->v,bottom->y-top->y);
+   short_x=long_x;
+   short_dx=this->get_slope(top->x,middle->x,middle->y-top->y);
+   for (y=top->y;y<bottom->y;++y)
+   {
+    if (y==middle->y)
+    {
+     short_x=middle->x*FIXED_ONE;
+     short_dx=this->get_slope(middle->x,bottom->x,bottom->y-middle->y);
+    }
+    if (y>=height) break;
+    if (y>=0) this->draw_span(y,long_x,short_x,long_u,long_v);
+    long_x+=long_dx;
+    long_u+=long_du;
+    long_v+=long_dv;
+    short_x+=short_dx;
+   }
+
+  }
+
+ }
+
+}
+
+void Texture::draw_quad(const Texture_Vertex &first,const Texture_Vertex &second,const Texture_Vertex &third,const Texture_Vertex &fourth)
+{
+ this->draw_triangle(first,second,third);
+ this->draw_triangle(first,third,fourth);
+}
+
+Text::Text()
+{
+ current_x=0;
+ current_y=0;
+ font=NULL;
+ surface=NULL;
+ glyph_pixels=NULL;
+ glyph_spans=NULL;
+ glyph_width=0;
+ glyph_height=0;
+ font_revision=0;
+ font_transparent=false;
+ proportional=false;
+ cache=NULL;
+ cache_size=0;
+ clock=0;
+}
+
+Text::~Text()
+{
+ this->clear_cache();
+ this->clear_glyphs();
+}
+
+void Text::increase_position(const char target)
+{
+ font->increase_x(this->get_advance(target));
+}
+
+void Text::restore_position()
+{
+ font->set_position(current_x,current_y);
+}
+
+void Text::clear_glyphs()
+{
+ if (glyph_pixels!=NULL)
+ {
+  delete[] glyph_pixels;
+  glyph_pixels=NULL;
+ }
+ if (glyph_spans!=NULL)
+ {
+  delete[] glyph_spans;
+  glyph_spans=NULL;
+ }
+
+}
+
+unsigned long int Text::count_spans(const bool *opaque,unsigned long int &pixels) const
+{
+ unsigned long int x,y,run,amount;
+ size_t position;
+ amount=0;
+ pixels=0;
+ for (y=0;y<glyph_height;++y)
+ {
+  position=static_cast<size_t>(y)*static_cast<size_t>(glyph_width);
+  x=0;
+  while (x<glyph_width)
+  {
+   while ((x<glyph_width)&&(opaque[position+x]==false)) ++x;
+   run=x;
+   while ((x<glyph_width)&&(opaque[position+x]==true)) ++x;
+   if (x>run)
+   {
+    ++amount;
+    pixels+=x-run;
+   }
+
+  }
+
+ }
+ return amount;
+}
+
+void Text::create_glyphs()
+{
+ unsigned long int index,x,y,run,stop,pixels,span_total,pixel_total;
+ size_t position,length;
+ unsigned short int *frame;
+ bool *opaque;
+ bool transparent;
+ frame=NULL;
+ opaque=NULL;
+ glyph_width=font->get_width();
+ glyph_height=font->get_height();
+ length=static_cast<size_t>(glyph_width)*static_cast<size_t>(glyph_height);
+ transparent=font->get_transparent();
+ font_revision=font->get_revision();
+ font_transparent=transparent;
+ try
+ {
+  frame=new unsigned short int[length];
+  opaque=new bool[length];
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for font");
+ }
+ span_total=0;
+ pixel_total=0;
+ for (index=0;index<128;++index)
+ {
+  font->copy_frame(index+1,frame,opaque);
+  if (transparent==false) memset(opaque,1,length*sizeof(bool));
+  glyphs[index].spans=3*static_cast<size_t>(span_total);
+  glyphs[index].pixels=pixel_total;
+  glyphs[index].span_amount=this->count_spans(opaque,pixels);
+  span_total+=glyphs[index].span_amount;
+  pixel_total+=pixels;
+ }
+ try
+ {
+  glyph_pixels=new unsigned short int[pixel_total+1];
+  glyph_spans=new unsigned short int[3*span_total+3];
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for font");
+ }
+ for (index=0;index<128;++index)
+ {
+  font->copy_frame(index+1,frame,opaque);
+  if (transparent==false) memset(opaque,1,length*sizeof(bool));
+  glyphs[index].left=glyph_width;
+  stop=0;
+  pixels=glyphs[index].pixels;
+  span_total=glyphs[index].spans;
+  for (y=0;y<glyph_height;++y)
+  {
+   position=static_cast<size_t>(y)*static_cast<size_t>(glyph_width);
+   x=0;
+   while (x<glyph_width)
+   {
+    while ((x<glyph_width)&&(opaque[position+x]==false)) ++x;
+    run=x;
+    while ((x<glyph_width)&&(opaque[position+x]==true)) ++x;
+    if (x>run)
+    {
+     glyph_spans[span_total]=y;
+     glyph_spans[span_total+1]=run;
+     glyph_spans[span_total+2]=x-run;
+     memcpy(glyph_pixels+pixels,frame+position+run,static_cast<size_t>(x-run)*sizeof(unsigned short int));
+     if (run<glyphs[index].left) glyphs[index].left=run;
+     if (x>stop) stop=x;
+     pixels+=x-run;
+     span_total+=3;
+    }
+
+   }
+
+  }
+  if (stop==0) glyphs[index].left=0;
+  glyphs[index].width=stop-glyphs[index].left;
+ }
+ delete[] frame;
+ delete[] opaque;
+}
+
+void Text::prepare_glyphs()
+{
+ bool changed;
+ changed=(surface!=font->get_surface())||(glyph_pixels==NULL)||(font_revision!=font->get_revision())||(font_transparent!=font->get_transparent());
+ if ((glyph_width!=font->get_width())||(glyph_height!=font->get_height())) changed=true;
+ if ((changed==true)&&(font->get_length()>0))
+ {
+  this->flush_cache();
+  this->clear_glyphs();
+  surface=font->get_surface();
+  this->create_glyphs();
+ }
+
+}
+
+bool Text::check_character(const char target) const
+{
+ return (target>=32)&&(static_cast<unsigned char>(target)<128);
+}
+
+unsigned long int Text::get_advance(const char target) const
+{
+ unsigned long int advance;
+ advance=glyph_width;
+ if (proportional==true)
+ {
+  advance=glyph_width/2;
+  if (glyphs[static_cast<unsigned char>(target)].width>0) advance=glyphs[static_cast<unsigned char>(target)].width+1;
+ }
+ return advance;
+}
+
+void Text::draw_glyph(const Glyph &target,const unsigned long int x,const unsigned long int y)
+{
+ unsigned long int index,position,start,stop,line,width,height,shift;
+ const unsigned short int *span;
+ const unsigned short int *source;
+ width=surface->get_frame_width();
+ height=surface->get_frame_height();
+ shift=0;
+ if (proportional==true) shift=target.left;
+ span=glyph_spans+target.spans;
+ source=glyph_pixels+target.pixels;
+ for (index=0;index<target.span_amount;++index)
+ {
+  line=y+span[0];
+  start=x+span[1]-shift;
+  stop=start+span[2];
+  if ((line<height)&&(start<width))
+  {
+   if (stop>width) stop=width;
+   if (surface->is_indexed()==true)
+   {
+    for (position=start;position<stop;++position)
+    {
+     surface->draw_native_pixel(position,line,source[position-start]);
+    }
+
+   }
+   else
+   {
+    memcpy(surface->get_buffer()+static_cast<size_t>(line)*static_cast<size_t>(width)+start,source,static_cast<size_t>(stop-start)*sizeof(unsigned short int));
+   }
+
+  }
+  source+=span[2];
+  span+=3;
+ }
+
+}
+
+void Text::clear_entry(Text_Cache &target)
+{
+ if (target.text!=NULL)
+ {
+  delete[] target.text;
+  target.text=NULL;
+ }
+ if (target.pixels!=NULL)
+ {
+  delete[] target.pixels;
+  target.pixels=NULL;
+ }
+ if (target.spans!=NULL)
+ {
+  delete[] target.spans;
+  target.spans=NULL;
+ }
+ if (target.rows!=NULL)
+ {
+  delete[] target.rows;
+  target.rows=NULL;
+ }
+ target.width=0;
+ target.height=0;
+ target.used=0;
+}
+
+void Text::clear_cache()
+{
+ unsigned long int index;
+ if (cache!=NULL)
+ {
+  for (index=0;index<cache_size;++index)
+  {
+   this->clear_entry(cache[index]);
+  }
+  delete[] cache;
+  cache=NULL;
+ }
+
+}
+
+Text_Cache *Text::find_entry(const char *text)
+{
+ unsigned long int index;
+ Text_Cache *target;
+ target=NULL;
+ for (index=0;index<cache_size;++index)
+ {
+  if (cache[index].text!=NULL)
+  {
+   if (strcmp(cache[index].text,text)==0)
+   {
+    target=cache+index;
+    break;
+   }
+
+  }
+
+ }
+ return target;
+}
+
+Text_Cache *Text::get_free_entry()
+{
+ unsigned long int index;
+ Text_Cache *target;
+ target=cache;
+ for (index=0;index<cache_size;++index)
+ {
+  if (cache[index].text==NULL)
+  {
+   target=cache+index;
+   break;
+  }
+  if (cache[index].used<target->used) target=cache+index;
+ }
+ return target;
+}
+
+void Text::render_entry(Text_Cache &target,const char *text)
+{
+ unsigned long int x,y,run,pen,shift,amount;
+ size_t index,length,position,span;
+ const unsigned short int *source;
+ const unsigned short int *piece;
+ const Glyph *glyph;
+ bool *opaque;
+ opaque=NULL;
+ length=strlen(text);
+ target.width=this->get_text_width(text);
+ target.height=glyph_height;
+ try
+ {
+  target.text=new char[length+1];
+  target.pixels=new unsigned short int[static_cast<size_t>(target.width)*static_cast<size_t>(target.height)+1];
+  target.rows=new size_t[target.height+1];
+  opaque=new bool[static_cast<size_t>(target.width)*static_cast<size_t>(target.height)+1];
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for text cache");
+ }
+ strcpy(target.text,text);
+ memset(opaque,0,(static_cast<size_t>(target.width)*static_cast<size_t>(target.height)+1)*sizeof(bool));
+ pen=0;
+ for (index=0;index<length;++index)
+ {
+  if (this->check_character(text[index])==false) continue;
+  glyph=glyphs+static_cast<unsigned char>(text[index]);
+  shift=0;
+  if (proportional==true) shift=glyph->left;
+  piece=glyph_spans+glyph->spans;
+  source=glyph_pixels+glyph->pixels;
+  for (amount=0;amount<glyph->span_amount;++amount)
+  {
+   position=static_cast<size_t>(piece[0])*static_cast<size_t>(target.width)+pen+piece[1]-shift;
+   memcpy(target.pixels+position,source,static_cast<size_t>(piece[2])*sizeof(unsigned short int));
+   memset(opaque+position,1,static_cast<size_t>(piece[2])*sizeof(bool));
+   source+=piece[2];
+   piece+=3;
+  }
+  pen+=this->get_advance(text[index]);
+ }
+ span=0;
+ for (y=0;y<target.height;++y)
+ {
+  position=static_cast<size_t>(y)*static_cast<size_t>(target.width);
+  x=0;
+  while (x<target.width)
+  {
+   while ((x<target.width)&&(opaque[position+x]==false)) ++x;
+   run=x;
+   while ((x<target.width)&&(opaque[position+x]==true)) ++x;
+   if (x>run) span+=2;
+  }
+
+ }
+ try
+ {
+  target.spans=new unsigned long int[span+2];
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for text cache");
+ }
+ span=0;
+ for (y=0;y<target.height;++y)
+ {
+  target.rows[y]=span;
+  position=static_cast<size_t>(y)*static_cast<size_t>(target.width);
+  x=0;
+  while (x<target.width)
+  {
+   while ((x<target.width)&&(opaque[position+x]==false)) ++x;
+   run=x;
+   while ((x<target.width)&&(opaque[position+x]==true)) ++x;
+   if (x>run)
+   {
+    target.spans[span]=run;
+    target.spans[span+1]=x-run;
+    span+=2;
+   }
+
+  }
+
+ }
+ target.rows[target.height]=span;
+ delete[] opaque;
+}
+
+void Text::draw_entry(const Text_Cache &target)
+{
+ unsigned long int x,y,start,stop,stop_y,width;
+ size_t span;
+ unsigned short int *output;
+ const unsigned short int *source;
+ width=surface->get_frame_width();
+ if ((current_x<width)&&(current_y<surface->get_frame_height()))
+ {
+  stop_y=surface->get_frame_height()-current_y;
+  if (stop_y>target.height) stop_y=target.height;
+  for (y=0;y<stop_y;++y)
+  {
+   source=target.pixels+static_cast<size_t>(y)*static_cast<size_t>(target.width);
+   for (span=target.rows[y];span<target.rows[y+1];span+=2)
+   {
+    start=current_x+target.spans[span];
+    stop=start+target.spans[span+1];
+    if (start>=width) break;
+    if (stop>width) stop=width;
+    if (surface->is_indexed()==true)
+    {
+     for (x=start;x<stop;++x)
+     {
+      surface->draw_native_pixel(x,current_y+y,source[x-current_x]);
+     }
+
+    }
+    else
+    {
+     output=surface->get_buffer()+static_cast<size_t>(current_y+y)*static_cast<size_t>(width);
+     memcpy(output+start,source+start-current_x,static_cast<size_t>(stop-start)*sizeof(unsigned short int));
+    }
+
+   }
+
+  }
+
+ }
+
+}
+
+void Text::draw_cached_text(const char *text)
+{
+ Text_Cache *target;
+ this->prepare_glyphs();
+ ++clock;
+ target=this->find_entry(text);
+ if (target==NULL)
+ {
+  target=this->get_free_entry();
+  this->clear_entry(*target);
+  this->render_entry(*target,text);
+ }
+ target->used=clock;
+ this->draw_entry(*target);
+ font->set_position(current_x+target->width,current_y);
+}
+
+void Text::set_position(const unsigned long int x,const unsigned long int y)
+{
+ font->set_position(x,y);
+ current_x=x;
+ current_y=y;
+}
+
+void Text::load_font(Sprite *target)
+{
+ font=target;
+ font->set_frames(128);
+ font->set_kind(HORIZONTAL_STRIP);
+ this->flush_cache();
+ this->clear_glyphs();
+ surface=font->get_surface();
+ if ((surface!=NULL)&&(font->get_length()>0)) this->create_glyphs();
+}
+
+void Text::draw_character(const char target)
+{
+ this->prepare_glyphs();
+ if (static_cast<unsigned char>(target)<128)
+ {
+  this->draw_glyph(glyphs[static_cast<unsigned char>(target)],font->get_x(),font->get_y());
+ }
+
+}
+
+void Text::draw_text(const char *text)
+{
+ size_t index,length;
+ if (cache!=NULL)
+ {
+  this->draw_cached_text(text);
+ }
+ else
+ {
+  length=strlen(text);
+  this->restore_position();
+  for (index=0;index<length;++index)
+  {
+   if (this->check_character(text[index])==false) continue;
+   this->draw_character(text[index]);
+   this->increase_position(text[index]);
+  }
+
+ }
+
+}
+
+void Text::draw_character(const unsigned long int x,const unsigned long int y,const char target)
+{
+ this->set_position(x,y);
+ this->draw_character(target);
+}
+
+void Text::draw_text(const unsigned long int x,const unsigned long int y,const char *text)
+{
+ this->set_position(x,y);
+ this->draw_text(text);
+}
+
+void Text::set_cache_size(const unsigned long int amount)
+{
+ unsigned long int index;
+ this->clear_cache();
+ cache_size=amount;
+ if (cache_size>0)
+ {
+  try
+  {
+   cache=new Text_Cache[cache_size];
+  }
+  catch (...)
+  {
+   Halt("Can't allocate memory for text cache");
+  }
+  for (index=0;index<cache_size;++index)
+  {
+   cache[index].text=NULL;
+   cache[index].pixels=NULL;
+   cache[index].spans=NULL;
+   cache[index].rows=NULL;
+   cache[index].width=0;
+   cache[index].height=0;
+   cache[index].used=0;
+  }
+
+ }
+
+}
+
+unsigned long int Text::get_cache_size() const
+{
+ return cache_size;
+}
+
+void Text::flush_cache()
+{
+ unsigned long int index;
+ if (cache!=NULL)
+ {
+  for (index=0;index<cache_size;++index)
+  {
+   this->clear_entry(cache[index]);
+  }
+
+ }
+
+}
+
+void Text::set_proportional(const bool enabled)
+{
+ proportional=enabled;
+ this->flush_cache();
+}
+
+bool Text::get_proportional() const
+{
+ return proportional;
+}
+
+unsigned long int Text::get_text_width(const char *text)
+{
+ unsigned long int width;
+ size_t index,length;
+ this->prepare_glyphs();
+ width=0;
+ length=strlen(text);
+ for (index=0;index<length;++index)
+ {
+  if (this->check_character(text[index])==true) width+=this->get_advance(text[index]);
+ }
+ return width;
+}
+
+Collision::Collision()
+{
+ first.x=0;
+ first.y=0;
+ first.width=0;
+ first.height=0;
+ second=first;
+}
+
+Collision::~Collision()
+{
+
+}
+
+void Collision::set_target(const Collision_Box &first_target,const Collision_Box &second_target)
+{
+ first=first_target;
+ second=second_target;
+}
+
+bool Collision::check_horizontal_collision() const
+{
+ bool result;
+ result=false;
+ if ((first.x+first.width)>=second.x)
+ {
+  if (first.x<=(second.x+second.width)) result=true;
+ }
+ return result;
+}
+
+bool Collision::check_vertical_collision() const
+{
+ bool result;
+ result=false;
+ if ((first.y+first.height)>=second.y)
+ {
+  if (first.y<=(second.y+second.height)) result=true;
+ }
+ return result;
+}
+
+bool Collision::check_collision() const
+{
+ return this->check_horizontal_collision() || this->check_vertical_collision();
+}
+
+bool Collision::check_horizontal_collision(const Collision_Box &first_target,const Collision_Box &second_target)
+{
+ this->set_target(first_target,second_target);
+ return this->check_horizontal_collision();
+}
+
+bool Collision::check_vertical_collision(const Collision_Box &first_target,const Collision_Box &second_target)
+{
+ this->set_target(first_target,second_target);
+ return this->check_vertical_collision();
+}
+
+bool Collision::check_collision(const Collision_Box &first_target,const Collision_Box &second_target)
+{
+ this->set_target(first_target,second_target);
+ return this->check_collision();
+}
+
+Collision_Box Collision::generate_box(const unsigned long int x,const unsigned long int y,const unsigned long int width,const unsigned long int height) const
+{
+ Collision_Box result;
+ result.x=x;
+ result.y=y;
+ result.width=width;
+ result.height=height;
+ return result;
+}
+
+Streamed_Background::Streamed_Background()
+{
+ surface=NULL;
+ slots=NULL;
+ chunk_buffer=NULL;
+ slot_amount=0;
+ columns=0;
+ rows=0;
+ margin=1;
+ clock=0;
+ sequence=0;
+ camera_x=0;
+ camera_y=0;
+ running=false;
+ memset(&head,0,sizeof(Chunk_head));
+}
+
+Streamed_Background::~Streamed_Background()
+{
+ this->close_world();
+}
+
+void Streamed_Background::check_head()
+{
+ if (strncmp(head.signature,"GCHK",4)!=0)
+ {
+  Halt("Invalid chunk file format");
+ }
+ if ((head.width==0)||(head.height==0)||(head.chunk_width==0)||(head.chunk_height==0))
+ {
+  Halt("Invalid chunk file format");
+ }
+
 }
 
-unsigned long int Image::get_height() const
+void Streamed_Background::create_slots(const unsigned long int amount)
 {
- return height;
+ unsigned long int index;
+ size_t length;
+ length=static_cast<size_t>(head.chunk_width)*static_cast<size_t>(head.chunk_height);
+ slot_amount=amount;
+ try
+ {
+  slots=new Chunk_Slot[slot_amount];
+  chunk_buffer=new IMG_Pixel[length];
+  for (index=0;index<slot_amount;++index)
+  {
+   slots[index].pixels=NULL;
+   slots[index].chunk=0;
+   slots[index].used=0;
+   slots[index].order=0;
+   slots[index].state=EMPTY_CHUNK;
+  }
+  for (index=0;index<slot_amount;++index)
+  {
+   slots[index].pixels=new unsigned short int[length];
+  }
+
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for chunk cache");
+ }
+
 }
 
-size_t Image::get_length() const
+void Streamed_Background::start_loader()
 {
- return static_cast<size_t>(width)*static_cast<size_t>(height)*3;
+ pthread_mutex_init(&lock,NULL);
+ pthread_cond_init(&signal,NULL);
+ running=true;
+ if (pthread_create(&loader,NULL,stream_world_chunks,this)!=0)
+ {
+  Halt("Can't start chunk loader");
+ }
+
 }
 
-unsigned char *Image::get_data()
+void Streamed_Background::read_chunk(const unsigned long int chunk,unsigned short int *pixels)
 {
- return data;
+ size_t index,length;
+ length=static_cast<size_t>(head.chunk_width)*static_cast<size_t>(head.chunk_height);
+ target.set_position(static_cast<long int>(sizeof(Chunk_head)+static_cast<size_t>(chunk)*length*sizeof(IMG_Pixel)));
+ target.read(chunk_buffer,length*sizeof(IMG_Pixel));
+ for (index=0;index<length;++index)
+ {
+  pixels[index]=surface->pack_pixel(chunk_buffer[index].red,chunk_buffer[index].green,chunk_buffer[index].blue);
+ }
+
 }
 
-void Image::destroy_image()
+bool Streamed_Background::check_visible(const unsigned long int chunk,const Collision_Box &view) const
+{
+ unsigned long int column,row;
+ column=chunk%columns;
+ row=chunk/columns;
+ return (column>=view.x)&&(column<view.x+view.width)&&(row>=view.y)&&(row<view.y+view.height);
+}
+
+Collision_Box Streamed_Background::get_view(const unsigned long int extra) const
+{
+ unsigned long int left,top,right,bottom;
+ Collision_Box view;
+ left=0;
+ top=0;
+ if (camera_x>0) left=static_cast<unsigned long int>(camera_x);
+ if (camera_y>0) top=static_cast<unsigned long int>(camera_y);
+ right=left+surface->get_frame_width();
+ bottom=top+surface->get_frame_height();
+ if (camera_x<0) right-=static_cast<unsigned long int>(-camera_x);
+ if (camera_y<0) bottom-=static_cast<unsigned long int>(-camera_y);
+ left/=head.chunk_width;
+ top/=head.chunk_height;
+ right=(right+head.chunk_width-1)/head.chunk_width;
+ bottom=(bottom+head.chunk_height-1)/head.chunk_height;
+ left=(left>extra) ? left-extra:0;
+ top=(top>extra) ? top-extra:0;
+ right+=extra;
+ bottom+=extra;
+ if (right>columns) right=columns;
+ if (bottom>rows) bottom=rows;
+ if (left>right) left=right;
+ if (top>bottom) top=bottom;
+ view.x=left;
+ view.y=top;
+ view.width=right-left;
+ view.height=bottom-top;
+ return view;
+}
+
+void Streamed_Background::request_chunk(const unsigned long int chunk,const Collision_Box &view)
+{
+ unsigned long int index,victim;
+ bool found;
+ victim=slot_amount;
+ found=false;
+ for (index=0;index<slot_amount;++index)
+ {
+  if ((slots[index].state!=EMPTY_CHUNK)&&(slots[index].chunk==chunk))
+  {
+   slots[index].used=clock;
+   found=true;
+   break;
+  }
+  if (slots[index].state==EMPTY_CHUNK)
+  {
+   if ((victim==slot_amount)||(slots[victim].state!=EMPTY_CHUNK)) victim=index;
+  }
+  if ((slots[index].state==READY_CHUNK)&&(slots[index].used!=clock))
+  {
+   if (this->check_visible(slots[index].chunk,view)==false)
+   {
+    if (victim==slot_amount)
+    {
+     victim=index;
+    }
+    else
+    {
+     if ((slots[victim].state==READY_CHUNK)&&(slots[index].used<slots[victim].used)) victim=index;
+    }
+
+   }
+
+  }
+
+ }
+ if ((found==false)&&(victim<slot_amount))
+ {
+  slots[victim].chunk=chunk;
+  slots[victim].used=clock;
+  slots[victim].order=sequence;
+  slots[victim].state=LOADING_CHUNK;
+  ++sequence;
+  pthread_cond_signal(&signal);
+ }
+
+}
+
+void Streamed_Background::request_range(const Collision_Box &range,const Collision_Box &view)
 {
- width=0;
- height=0;
- this->clear_buffer();
+ unsigned long int column,row;
+ for (row=range.y;row<range.y+range.height;++row)
+ {
+  for (column=range.x;column<range.x+range.width;++column)
+  {
+   this->request_chunk(row*columns+column,view);
+  }
+
+ }
+
 }
 
-Surface::Surface()
+void Streamed_Background::draw_chunk(const Chunk_Slot &slot)
+{
+ long int world_x,world_y,start_x,start_y,stop_x,stop_y,width,height,x,y;
+ unsigned short int *output;
+ const unsigned short int *source;
+ width=static_cast<long int>(surface->get_frame_width());
+ height=static_cast<long int>(surface->get_frame_height());
+ world_x=static_cast<long int>((slot.chunk%columns)*head.chunk_width);
+ world_y=static_cast<long int>((slot.chunk/columns)*head.chunk_height);
+ start_x=world_x-camera_x;
+ start_y=world_y-camera_y;
+ stop_x=start_x+static_cast<long int>(head.chunk_width);
+ stop_y=start_y+static_cast<long int>(head.chunk_height);
+ if (world_x+static_cast<long int>(head.chunk_width)>static_cast<long int>(head.width)) stop_x=static_cast<long int>(head.width)-camera_x;
+ if (world_y+static_cast<long int>(head.chunk_height)>static_cast<long int>(head.height)) stop_y=static_cast<long int>(head.height)-camera_y;
+ if (start_x<0) start_x=0;
+ if (start_y<0) start_y=0;
+ if (stop_x>width) stop_x=width;
+ if (stop_y>height) stop_y=height;
+ if ((start_x<stop_x)&&(start_y<stop_y))
+ {
+  if (surface->is_indexed()==true)
+  {
+   for (y=start_y;y<stop_y;++y)
+   {
+    for (x=start_x;x<stop_x;++x)
+    {
+     surface->draw_native_pixel(x,y,slot.pixels[(y+camera_y-world_y)*static_cast<long int>(head.chunk_width)+(x+camera_x-world_x)]);
+    }
+
+   }
+
+  }
+  else
+  {
+   output=surface->get_buffer();
+   for (y=start_y;y<stop_y;++y)
+   {
+    source=slot.pixels+(y+camera_y-world_y)*static_cast<long int>(head.chunk_width)+(start_x+camera_x-world_x);
+    memcpy(output+y*width+start_x,source,static_cast<size_t>(stop_x-start_x)*sizeof(unsigned short int));
+   }
+
+  }
+
+ }
+
+}
+
+void Streamed_Background::initialize(Frame *screen)
 {
- width=0;
- height=0;
- image=NULL;
- surface=NULL;
+ surface=screen;
 }
 
-Surface::~Surface()
+void Streamed_Background::create_chunk_file(const char *name,Image &source,const unsigned long int chunk_width,const unsigned long int chunk_height)
 {
- surface=NULL;
- if (image!=NULL) free(image);
+ Output_File output;
+ Chunk_head setting;
+ IMG_Pixel *chunk;
+ const unsigned char *data;
+ const unsigned char *palette;
+ unsigned long int column,row,x,y,source_x,source_y,color;
+ size_t position;
+ chunk=NULL;
+ if ((source.get_width()==0)||(source.get_height()==0)) Halt("The chunk source image is empty");
+ if ((chunk_width==0)||(chunk_height==0)||(chunk_width>USHRT_MAX)||(chunk_height>USHRT_MAX)) Halt("Invalid chunk size");
+ memset(&setting,0,sizeof(Chunk_head));
+ memcpy(setting.signature,"GCHK",4);
+ setting.width=source.get_width();
+ setting.height=source.get_height();
+ setting.chunk_width=chunk_width;
+ setting.chunk_height=chunk_height;
+ try
+ {
+  chunk=new IMG_Pixel[static_cast<size_t>(chunk_width)*static_cast<size_t>(chunk_height)];
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for chunk");
+ }
+ data=source.get_data();
+ palette=source.get_palette();
+ output.open(name);
+ output.write(&setting,sizeof(Chunk_head));
+ for (row=0;row<(setting.height+chunk_height-1)/chunk_height;++row)
+ {
+  for (column=0;column<(setting.width+chunk_width-1)/chunk_width;++column)
+  {
+   memset(chunk,0,static_cast<size_t>(chunk_width)*static_cast<size_t>(chunk_height)*sizeof(IMG_Pixel));
+   for (y=0;y<chunk_height;++y)
+   {
+    source_y=row*chunk_height+y;
+    if (source_y>=setting.height) break;
+    for (x=0;x<chunk_width;++x)
+    {
+     source_x=column*chunk_width+x;
+     if (source_x>=setting.width) break;
+     position=static_cast<size_t>(source_x)+static_cast<size_t>(source_y)*static_cast<size_t>(setting.width);
+     if (source.get_type()==INDEXED_IMAGE)
+     {
+      color=3*static_cast<unsigned long int>(data[position]);
+      memcpy(chunk+y*chunk_width+x,palette+color,3);
+     }
+     else
+     {
+      memcpy(chunk+y*chunk_width+x,data+3*position,3);
+     }
+
+    }
+
+   }
+   output.write(chunk,static_cast<size_t>(chunk_width)*static_cast<size_t>(chunk_height)*sizeof(IMG_Pixel));
+  }
+
+ }
+ output.close();
+ delete[] chunk;
 }
 
-IMG_Pixel *Surface::create_buffer(const unsigned long int image_width,const unsigned long int image_height)
+void Streamed_Background::open_world(const char *name,const unsigned long int cache_size)
 {
- IMG_Pixel *result;
- size_t length;
- length=static_cast<size_t>(image_width)*static_cast<size_t>(image_height);
- result=reinterpret_cast<IMG_Pixel*>(calloc(length,3));
- if (result==NULL)
+ unsigned long int minimum;
+ this->close_world();
+ if (surface==NULL) Halt("The streamed background isn't initialized");
+ target.open(name);
+ target.read(&head,sizeof(Chunk_head));
+ this->check_head();
+ columns=(head.width+head.chunk_width-1)/head.chunk_width;
+ rows=(head.height+head.chunk_height-1)/head.chunk_height;
+ minimum=(surface->get_frame_width()/head.chunk_width+2)*(surface->get_frame_height()/head.chunk_height+2);
+ if (cache_size>minimum) minimum=cache_size;
+ this->create_slots(minimum);
+ this->start_loader();
+}
+
+void Streamed_Background::close_world()
+{
+ unsigned long int index;
+ if (running==true)
  {
-  Halt("Can't allocate memory for image buffer");
+  pthread_mutex_lock(&lock);
+  running=false;
+  pthread_cond_signal(&signal);
+  pthread_mutex_unlock(&lock);
+  pthread_join(loader,NULL);
+  pthread_cond_destroy(&signal);
+  pthread_mutex_destroy(&lock);
  }
- return result;
+ if (slots!=NULL)
+ {
+  for (index=0;index<slot_amount;++index)
+  {
+   if (slots[index].pixels!=NULL) delete[] slots[index].pixels;
+  }
+  delete[] slots;
+  slots=NULL;
+ }
+ if (chunk_buffer!=NULL)
+ {
+  delete[] chunk_buffer;
+  chunk_buffer=NULL;
+ }
+ slot_amount=0;
+ columns=0;
+ rows=0;
+ target.close();
 }
 
-void Surface::save()
+void Streamed_Background::set_margin(const unsigned long int amount)
 {
- surface->save();
+ margin=amount;
 }
 
-void Surface::restore()
+void Streamed_Background::set_camera(const long int x,const long int y)
 {
- surface->restore();
+ camera_x=x;
+ camera_y=y;
 }
 
-void Surface::clear_buffer()
+long int Streamed_Background::get_camera_x() const
 {
- if (image!=NULL)
+ return camera_x;
+}
+
+long int Streamed_Background::get_camera_y() const
+{
+ return camera_y;
+}
+
+unsigned long int Streamed_Background::get_world_width() const
+{
+ return head.width;
+}
+
+unsigned long int Streamed_Background::get_world_height() const
+{
+ return head.height;
+}
+
+unsigned long int Streamed_Background::get_resident()
+{
+ unsigned long int index,amount;
+ amount=0;
+ if (running==true)
  {
-  free(image);
-  image=NULL;
+  pthread_mutex_lock(&lock);
+  for (index=0;index<slot_amount;++index)
+  {
+   if (slots[index].state==READY_CHUNK) ++amount;
+  }
+  pthread_mutex_unlock(&lock);
+ }
+ return amount;
+}
+
+void Streamed_Background::draw_world()
+{
+ unsigned long int index;
+ Collision_Box view;
+ if (running==true)
+ {
+  view=this->get_view(0);
+  pthread_mutex_lock(&lock);
+  ++clock;
+  this->request_range(view,view);
+  this->request_range(this->get_view(margin),view);
+  for (index=0;index<slot_amount;++index)
+  {
+   if ((slots[index].state==READY_CHUNK)&&(this->check_visible(slots[index].chunk,view)==true)) this->draw_chunk(slots[index]);
+  }
+  pthread_mutex_unlock(&lock);
  }
 
 }
 
-void Surface::set_size(const unsigned long int image_width,const unsigned long int image_height)
+void Streamed_Background::load_chunks()
 {
- width=image_width;
- height=image_height;
+ unsigned long int index,selected,chunk;
+ unsigned short int *pixels;
+ pthread_mutex_lock(&lock);
+ while (running==true)
+ {
+  selected=slot_amount;
+  for (index=0;index<slot_amount;++index)
+  {
+   if (slots[index].state==LOADING_CHUNK)
+   {
+    if ((selected==slot_amount)||(slots[index].order<slots[selected].order)) selected=index;
+   }
+
+  }
+  if (selected==slot_amount)
+  {
+   pthread_cond_wait(&signal,&lock);
+   continue;
+  }
+  chunk=slots[selected].chunk;
+  pixels=slots[selected].pixels;
+  pthread_mutex_unlock(&lock);
+  this->read_chunk(chunk,pixels);
+  pthread_mutex_lock(&lock);
+  slots[selected].state=READY_CHUNK;
+ }
+ pthread_mutex_unlock(&lock);
 }
 
-void Surface::set_buffer(IMG_Pixel *buffer)
+Parallax_Background::Parallax_Background()
 {
- image=buffer;
+ surface=NULL;
+ layers=NULL;
+ amount=0;
+ camera_x=0;
+ camera_y=0;
 }
 
-size_t Surface::get_offset(const unsigned long int start,const unsigned long int x,const unsigned long int y,const unsigned long int target_width)
+Parallax_Background::~Parallax_Background()
 {
- return static_cast<size_t>(start)+static_cast<size_t>(x)+static_cast<size_t>(y)*static_cast<size_t>(target_width);
+ unsigned long int index;
+ for (index=0;index<amount;++index)
+ {
+  this->clear_layer(layers[index]);
+ }
+ if (layers!=NULL) delete[] layers;
 }
 
-size_t Surface::get_offset(const unsigned long int start,const unsigned long int x,const unsigned long int y) const
+void Parallax_Background::clear_layer(Parallax_Layer &target)
 {
- return static_cast<size_t>(start)+static_cast<size_t>(x)+static_cast<size_t>(y)*static_cast<size_t>(width);
+ if (target.pixels!=NULL)
+ {
+  delete[] target.pixels;
+  target.pixels=NULL;
+ }
+ if (target.spans!=NULL)
+ {
+  delete[] target.spans;
+  target.spans=NULL;
+ }
+ if (target.rows!=NULL)
+ {
+  delete[] target.rows;
+  target.rows=NULL;
+ }
+
 }
 
-void Surface::draw_image_pixel(const size_t offset,const unsigned long int x,const unsigned long int y)
+size_t Parallax_Background::scan_spans(Parallax_Layer &target,const bool store)
+{
+ unsigned long int x,y,run;
+ size_t index,position;
+ unsigned short int key;
+ key=target.pixels[0];
+ index=0;
+ for (y=0;y<target.height;++y)
+ {
+  if (store==true) target.rows[y]=index;
+  position=this->get_offset(y,target.width);
+  x=0;
+  while (x<target.width)
+  {
+   while ((x<target.width)&&(target.pixels[position+x]==key)) ++x;
+   run=x;
+   while ((x<target.width)&&(target.pixels[position+x]!=key)) ++x;
+   if (x>run)
+   {
+    if (store==true)
+    {
+     target.spans[index]=run;
+     target.spans[index+1]=x-run;
+    }
+    index+=2;
+   }
+
+  }
+
+ }
+ if (store==true) target.rows[target.height]=index;
+ return index;
+}
+
+void Parallax_Background::prepare_layer(Parallax_Layer &target)
 {
- surface->draw_pixel(x,y,image[offset].red,image[offset].green,image[offset].blue);
+ size_t length;
+ target.width=target.background->get_width();
+ target.height=target.background->get_height();
+ target.frame=target.background->get_frame();
+ length=static_cast<size_t>(target.width)*static_cast<size_t>(target.height);
+ if ((target.pixels==NULL)||(length>target.pixel_capacity))
+ {
+  if (target.pixels!=NULL) delete[] target.pixels;
+  target.pixels=NULL;
+  try
+  {
+   target.pixels=new unsigned short int[length];
+  }
+  catch (...)
+  {
+   Halt("Can't allocate memory for parallax layer");
+  }
+  target.pixel_capacity=length;
+ }
+ target.background->copy_frame(target.pixels);
+ if ((target.transparent==true)&&(length>0))
+ {
+  length=static_cast<size_t>(target.height)+1;
+  if ((target.rows==NULL)||(length>target.row_capacity))
+  {
+   if (target.rows!=NULL) delete[] target.rows;
+   target.rows=NULL;
+   try
+   {
+    target.rows=new size_t[length];
+   }
+   catch (...)
+   {
+    Halt("Can't allocate memory for parallax layer");
+   }
+   target.row_capacity=length;
+  }
+  length=this->scan_spans(target,false)+2;
+  if ((target.spans==NULL)||(length>target.span_capacity))
+  {
+   if (target.spans!=NULL) delete[] target.spans;
+   target.spans=NULL;
+   try
+   {
+    target.spans=new unsigned long int[length];
+   }
+   catch (...)
+   {
+    Halt("Can't allocate memory for parallax layer");
+   }
+   target.span_capacity=length;
+  }
+  this->scan_spans(target,true);
+ }
+
 }
 
-bool Surface::compare_pixels(const size_t first,const size_t second) const
+void Parallax_Background::resize_layers()
 {
- bool result;
- result=false;
- if (image[first].red!=image[second].red)
+ Parallax_Layer *target;
+ unsigned long int index;
+ target=NULL;
+ try
  {
-  result=true;
-  goto finish;
+  target=new Parallax_Layer[amount+1];
  }
- if (image[first].green!=image[second].green)
+ catch (...)
  {
-  result=true;
-  goto finish;
+  Halt("Can't allocate memory for parallax layer list");
  }
- if (image[first].blue!=image[second].blue)
+ for (index=0;index<amount;++index)
  {
-  result=true;
-  goto finish;
+  target[index]=layers[index];
  }
- finish: ;
- return result;
+ if (layers!=NULL) delete[] layers;
+ layers=target;
+}
+
+size_t Parallax_Background::get_offset(const unsigned long int y,const unsigned long int width) const
+{
+ return static_cast<size_t>(y)*static_cast<size_t>(width);
+}
+
+unsigned long int Parallax_Background::get_shift(const long int position,const float speed,const unsigned long int limit) const
+{
+ long int shift;
+ shift=static_cast<long int>(static_cast<float>(position)*speed)%static_cast<long int>(limit);
+ if (shift<0) shift+=static_cast<long int>(limit);
+ return static_cast<unsigned long int>(shift);
+}
+
+void Parallax_Background::draw_opaque_layer(const Parallax_Layer &target,const unsigned long int shift_x,const unsigned long int shift_y)
+{
+ unsigned long int x,y,row,length,width,height;
+ unsigned short int *output;
+ const unsigned short int *source;
+ width=surface->get_frame_width();
+ height=surface->get_frame_height();
+ output=surface->get_buffer();
+ row=shift_y;
+ for (y=0;y<height;++y)
+ {
+  source=target.pixels+this->get_offset(row,target.width);
+  x=0;
+  length=target.width-shift_x;
+  if (length>width) length=width;
+  memcpy(output,source+shift_x,static_cast<size_t>(length)*sizeof(unsigned short int));
+  for (x=length;x<width;x+=length)
+  {
+   length=target.width;
+   if (length>width-x) length=width-x;
+   memcpy(output+x,source,static_cast<size_t>(length)*sizeof(unsigned short int));
+  }
+  output+=width;
+  ++row;
+  if (row==target.height) row=0;
+ }
+
 }
 
-unsigned long int Surface::get_surface_width() const
+void Parallax_Background::draw_transparent_layer(const Parallax_Layer &target,const unsigned long int shift_x,const unsigned long int shift_y)
 {
- return surface->get_frame_width();
+ unsigned long int y,row,tile,start,stop,width,height;
+ size_t span;
+ unsigned short int *output;
+ const unsigned short int *source;
+ width=surface->get_frame_width();
+ height=surface->get_frame_height();
+ output=surface->get_buffer();
+ row=shift_y;
+ for (y=0;y<height;++y)
+ {
+  source=target.pixels+this->get_offset(row,target.width);
+  for (span=target.rows[row];span<target.rows[row+1];span+=2)
+  {
+   for (tile=0;tile<width+shift_x;tile+=target.width)
+   {
+    start=tile+target.spans[span];
+    stop=start+target.spans[span+1];
+    if (stop<=shift_x) continue;
+    if (start>=width+shift_x) break;
+    if (start<shift_x) start=shift_x;
+    if (stop>width+shift_x) stop=width+shift_x;
+    memcpy(output+start-shift_x,source+start-tile,static_cast<size_t>(stop-start)*sizeof(unsigned short int));
+   }
+
+  }
+  output+=width;
+  ++row;
+  if (row==target.height) row=0;
+ }
+
 }
 
-unsigned long int Surface::get_surface_height() const
+void Parallax_Background::draw_indexed_layer(const Parallax_Layer &target,const unsigned long int shift_x,const unsigned long int shift_y)
 {
- return surface->get_frame_height();
+ unsigned long int x,y,width,height;
+ unsigned short int pixel;
+ width=surface->get_frame_width();
+ height=surface->get_frame_height();
+ for (y=0;y<height;++y)
+ {
+  for (x=0;x<width;++x)
+  {
+   pixel=target.pixels[this->get_offset((y+shift_y)%target.height,target.width)+(x+shift_x)%target.width];
+   if ((target.transparent==false)||(pixel!=target.pixels[0])) surface->draw_native_pixel(x,y,pixel);
+  }
+
+ }
+
 }
 
-void Surface::initialize(Screen *screen)
+void Parallax_Background::initialize(Frame *target)
 {
- surface=screen;
+ surface=target;
 }
 
-size_t Surface::get_length() const
+void Parallax_Background::add_layer(Background *target,const float speed_x,const float speed_y,const bool transparent)
 {
- return static_cast<size_t>(width)*static_cast<size_t>(height)*3;
+ this->resize_layers();
+ layers[amount].background=target;
+ layers[amount].pixels=NULL;
+ layers[amount].spans=NULL;
+ layers[amount].rows=NULL;
+ layers[amount].pixel_capacity=0;
+ layers[amount].span_capacity=0;
+ layers[amount].row_capacity=0;
+ layers[amount].speed_x=speed_x;
+ layers[amount].speed_y=speed_y;
+ layers[amount].transparent=transparent;
+ this->prepare_layer(layers[amount]);
+ ++amount;
 }
 
-IMG_Pixel *Surface::get_image()
+unsigned long int Parallax_Background::get_layer_amount() const
 {
- return image;
+ return amount;
 }
 
-void Surface::load_image(Image &buffer)
+void Parallax_Background::set_camera(const long int x,const long int y)
 {
- width=buffer.get_width();
- height=buffer.get_height();
- this->clear_buffer();
- image=this->create_buffer(width,height);
- memmove(image,buffer.get_data(),buffer.get_length());
+ camera_x=x;
+ camera_y=y;
 }
 
-unsigned long int Surface::get_image_width() const
+long int Parallax_Background::get_camera_x() const
 {
- return width;
+ return camera_x;
 }
 
-unsigned long int Surface::get_image_height() const
+long int Parallax_Background::get_camera_y() const
 {
- return height;
+ return camera_y;
 }
 
-void Surface::mirror_image(const MIRROR_TYPE kind)
+void Parallax_Background::draw_parallax()
 {
- unsigned long int x,y,index;
- IMG_Pixel *mirrored_image;
- x=0;
- y=0;
- mirrored_image=this->create_buffer(width,height);
- if (kind==MIRROR_HORIZONTAL)
+ unsigned long int index,shift_x,shift_y;
+ if (surface!=NULL)
  {
-  for (index=width*height;index>0;--index)
+  for (index=0;index<amount;++index)
   {
-   mirrored_image[this->get_offset(0,x,y)]=image[this->get_offset(0,(width-x-1),y)];
-   ++x;
-   if (x==width)
+   if (layers[index].frame!=layers[index].background->get_frame()) this->prepare_layer(layers[index]);
+   if ((layers[index].width==0)||(layers[index].height==0)) continue;
+   shift_x=this->get_shift(camera_x,layers[index].speed_x,layers[index].width);
+   shift_y=this->get_shift(camera_y,layers[index].speed_y,layers[index].height);
+   if (surface->is_indexed()==true)
    {
-    x=0;
-    ++y;
+    this->draw_indexed_layer(layers[index],shift_x,shift_y);
+   }
+   else
+   {
+    if (layers[index].transparent==true)
+    {
+     this->draw_transparent_layer(layers[index],shift_x,shift_y);
+    }
+    else
+    {
+     this->draw_opaque_layer(layers[index],shift_x,shift_y);
+    }
+
    }
 
   }
 
  }
- if (kind==MIRROR_VERTICAL)
- {
-  for (index=width*height;index>0;--index )
-  {
-   mirrored_image[this->get_offset(0,x,y)]=image[this->get_offset(0,x,(height-y-1))];
-   ++x;
-   if (x==width)
-   {
-    x=0;
-    ++y;
-   }
 
-  }
+}
+
+Scene::Scene()
+{
+ sprites=NULL;
+ amount=0;
+ used=0;
+}
+
+Scene::~Scene()
+{
+ if (sprites!=NULL) delete[] sprites;
+}
 
+void Scene::resize_scene()
+{
+ Sprite **target;
+ unsigned long int index;
+ target=NULL;
+ try
+ {
+  target=new Sprite*[amount+16];
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for scene");
  }
- free(image);
- image=mirrored_image;
+ for (index=0;index<used;++index)
+ {
+  target[index]=sprites[index];
+ }
+ if (sprites!=NULL) delete[] sprites;
+ sprites=target;
+ amount+=16;
 }
 
-void Surface::resize_image(const unsigned long int new_width,const unsigned long int new_height)
+void Scene::add_sprite(Sprite *target)
 {
- float x_ratio,y_ratio;
- unsigned long int x,y,steps;
- size_t index,location,position;
- IMG_Pixel *scaled_image;
- x=0;
- y=0;
- steps=new_width*new_height;
- scaled_image=this->create_buffer(new_width,new_height);
- x_ratio=static_cast<float>(width)/static_cast<float>(new_width);
- y_ratio=static_cast<float>(height)/static_cast<float>(new_height);
- for (index=0;index<steps;++index)
+ if (used==amount) this->resize_scene();
+ sprites[used]=target;
+ ++used;
+}
+
+void Scene::remove_sprite(Sprite *target)
+{
+ unsigned long int index;
+ for (index=0;index<used;++index)
  {
-  location=this->get_offset(0,x,y,new_width);
-  position=this->get_offset(0,(x_ratio*static_cast<float>(x)),(y_ratio*static_cast<float>(y)),width);
-  scaled_image[location]=image[position];
-  ++x;
-  if (x==new_width)
+  if (sprites[index]==target) break;
+ }
+ if (index<used)
+ {
+  sprites[index]->erase();
+  for (++index;index<used;++index)
   {
-   x=0;
-   ++y;
+   sprites[index-1]=sprites[index];
   }
-
+  --used;
  }
- free(image);
- image=scaled_image;
- width=new_width;
- height=new_height;
+
 }
 
-void Surface::horizontal_mirror()
+unsigned long int Scene::get_amount() const
 {
- this->mirror_image(MIRROR_HORIZONTAL);
+ return used;
 }
 
-void Surface::vertical_mirror()
+void Scene::erase()
 {
- this->mirror_image(MIRROR_VERTICAL);
+ unsigned long int index;
+ for (index=0;index<used;++index)
+ {
+  sprites[index]->erase();
+ }
+
 }
 
-Animation::Animation()
+void Scene::draw()
 {
- start=0;
- frame=1;
- frames=1;
+ unsigned long int index;
+ this->erase();
+ for (index=0;index<used;++index)
+ {
+  sprites[index]->draw_sprite();
+ }
+
 }
 
-Animation::~Animation()
+Display_List::Display_List()
 {
+ surface=NULL;
+ nodes=NULL;
+ order=NULL;
+ amount=0;
+ ordered=0;
+ dirty.x=0;
+ dirty.y=0;
+ dirty.width=0;
+ dirty.height=0;
+ dirty_used=false;
+ full=true;
+}
 
+Display_List::~Display_List()
+{
+ if (nodes!=NULL) delete[] nodes;
+ if (order!=NULL) delete[] order;
 }
 
-void Animation::set_frame(const unsigned long int target)
+void Display_List::resize_list()
 {
- if (target>0)
+ Display_Node *target;
+ unsigned long int index,length;
+ length=amount+16;
+ target=NULL;
+ try
  {
-  if (target<=frames) frame=target;
+  target=new Display_Node[length];
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for display list");
+ }
+ for (index=0;index<length;++index)
+ {
+  if (index<amount)
+  {
+   target[index]=nodes[index];
+  }
+  else
+  {
+   target[index].kind=EMPTY_NODE;
+  }
+
+ }
+ if (nodes!=NULL) delete[] nodes;
+ if (order!=NULL) delete[] order;
+ nodes=target;
+ amount=length;
+ try
+ {
+  order=new unsigned long int[amount];
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for display list");
  }
 
 }
 
-void Animation::increase_frame()
+unsigned long int Display_List::get_free_node()
 {
- ++frame;
- if (frame>frames)
+ unsigned long int index;
+ for (index=0;index<amount;++index)
  {
-  frame=1;
+  if (nodes[index].kind==EMPTY_NODE) break;
+ }
+ if (index==amount) this->resize_list();
+ nodes[index].sprite=NULL;
+ nodes[index].tileset=NULL;
+ nodes[index].background=NULL;
+ nodes[index].layer=0;
+ nodes[index].row=0;
+ nodes[index].column=0;
+ nodes[index].x=0;
+ nodes[index].y=0;
+ nodes[index].visible=true;
+ nodes[index].opaque=false;
+ nodes[index].active=false;
+ nodes[index].drawable=false;
+ nodes[index].drawn=false;
+ nodes[index].frame=0;
+ nodes[index].state=0;
+ nodes[index].previous_frame=0;
+ nodes[index].previous_state=0;
+ nodes[index].box=this->get_screen_box();
+ nodes[index].previous=nodes[index].box;
+ return index;
+}
+
+Collision_Box Display_List::get_screen_box() const
+{
+ Collision_Box target;
+ target.x=0;
+ target.y=0;
+ target.width=0;
+ target.height=0;
+ if (surface!=NULL)
+ {
+  target.width=surface->get_frame_width();
+  target.height=surface->get_frame_height();
  }
+ return target;
+}
 
+Collision_Box Display_List::clip_box(const Collision_Box &target) const
+{
+ Collision_Box screen,result;
+ screen=this->get_screen_box();
+ result=target;
+ if ((result.x>=screen.width)||(result.y>=screen.height))
+ {
+  result.width=0;
+  result.height=0;
+ }
+ else
+ {
+  if (result.width>screen.width-result.x) result.width=screen.width-result.x;
+  if (result.height>screen.height-result.y) result.height=screen.height-result.y;
+ }
+ return result;
 }
 
-void Animation::set_frames(const unsigned long int amount)
+bool Display_List::check_overlap(const Collision_Box &first,const Collision_Box &second) const
 {
- if (amount>1) frames=amount;
+ bool result;
+ result=false;
+ if ((first.x<second.x+second.width)&&(second.x<first.x+first.width))
+ {
+  result=(first.y<second.y+second.height)&&(second.y<first.y+first.height);
+ }
+ return result;
 }
 
-unsigned long int Animation::get_frames() const
+bool Display_List::check_inside(const Collision_Box &inner,const Collision_Box &outer) const
 {
- return frames;
+ bool result;
+ result=false;
+ if ((inner.x>=outer.x)&&(inner.x+inner.width<=outer.x+outer.width))
+ {
+  result=(inner.y>=outer.y)&&(inner.y+inner.height<=outer.y+outer.height);
+ }
+ return result;
 }
 
-unsigned long int Animation::get_frame() const
+void Display_List::merge_dirty(const Collision_Box &target)
 {
- return frame;
+ unsigned long int stop_x,stop_y;
+ if ((target.width>0)&&(target.height>0))
+ {
+  if (dirty_used==false)
+  {
+   dirty=target;
+   dirty_used=true;
+  }
+  else
+  {
+   stop_x=dirty.x+dirty.width;
+   stop_y=dirty.y+dirty.height;
+   if (target.x+target.width>stop_x) stop_x=target.x+target.width;
+   if (target.y+target.height>stop_y) stop_y=target.y+target.height;
+   if (target.x<dirty.x) dirty.x=target.x;
+   if (target.y<dirty.y) dirty.y=target.y;
+   dirty.width=stop_x-dirty.x;
+   dirty.height=stop_y-dirty.y;
+  }
+
+ }
+
 }
 
-Background::Background()
+void Display_List::sort_nodes()
 {
- background_width=0;
- background_height=0;
- maximum_width=0;
- maximum_height=0;
- current=0;
- current_kind=NORMAL_BACKGROUND;
+ unsigned long int index,position,current;
+ ordered=0;
+ for (index=0;index<amount;++index)
+ {
+  if (nodes[index].kind==EMPTY_NODE) continue;
+  position=ordered;
+  while (position>0)
+  {
+   current=order[position-1];
+   if (nodes[current].layer<=nodes[index].layer) break;
+   order[position]=current;
+   --position;
+  }
+  order[position]=index;
+  ++ordered;
+ }
+
 }
 
-Background::~Background()
+void Display_List::prepare_node(Display_Node &node)
 {
+ Collision_Box target;
+ target=this->get_screen_box();
+ node.frame=0;
+ node.state=0;
+ node.opaque=true;
+ switch (node.kind)
+ {
+  case SPRITE_NODE:
+  node.opaque=node.sprite->get_transparent()==false;
+  if (node.opaque==true)
+  {
+   target=node.sprite->get_box();
+  }
+  else
+  {
+   target=node.sprite->get_trimmed_box();
+  }
+  node.frame=node.sprite->get_frame();
+  if (node.opaque==true) node.state|=1;
+  if (node.sprite->get_horizontal_flip()==true) node.state|=2;
+  if (node.sprite->get_vertical_flip()==true) node.state|=4;
+  break;
+  case TILE_NODE:
+  target.x=node.x;
+  target.y=node.y;
+  target.width=node.tileset->get_tile_width();
+  target.height=node.tileset->get_tile_height();
+  node.state=node.row*node.tileset->get_columns()+node.column;
+  break;
+  case BACKGROUND_NODE:
+  node.frame=node.background->get_frame();
+  break;
+  case EMPTY_NODE:
+  break;
+ }
+ node.box=this->clip_box(target);
+ node.active=(node.visible==true)&&(node.box.width>0)&&(node.box.height>0);
+ node.drawable=node.active;
+}
 
+bool Display_List::check_change(const Display_Node &node) const
+{
+ bool result;
+ result=node.drawable!=node.drawn;
+ if ((node.frame!=node.previous_frame)||(node.state!=node.previous_state)) result=true;
+ if ((node.box.x!=node.previous.x)||(node.box.y!=node.previous.y)) result=true;
+ if ((node.box.width!=node.previous.width)||(node.box.height!=node.previous.height)) result=true;
+ return result;
 }
 
-void Background::get_maximum_width()
+void Display_List::find_occlusion()
 {
- maximum_width=background_width;
- if (maximum_width>this->get_surface_width())
+ unsigned long int index,cover;
+ for (index=0;index<ordered;++index)
  {
-  maximum_width=this->get_surface_width();
+  if (nodes[order[index]].active==false) continue;
+  for (cover=index+1;cover<ordered;++cover)
+  {
+   if ((nodes[order[cover]].active==true)&&(nodes[order[cover]].opaque==true))
+   {
+    if (this->check_inside(nodes[order[index]].box,nodes[order[cover]].box)==true)
+    {
+     nodes[order[index]].drawable=false;
+     break;
+    }
+
+   }
+
+  }
+
  }
 
 }
 
-void Background::get_maximum_height()
+void Display_List::find_dirty()
 {
- maximum_height=background_height;
- if (maximum_height>this->get_surface_height())
+ unsigned long int index;
+ for (index=0;index<ordered;++index)
  {
-  maximum_height=this->get_surface_height();
+  if (this->check_change(nodes[order[index]])==false) continue;
+  if (nodes[order[index]].kind==BACKGROUND_NODE)
+  {
+   if ((nodes[order[index]].drawable==true)||(nodes[order[index]].drawn==true)) full=true;
+  }
+  else
+  {
+   if (nodes[order[index]].drawn==true) this->merge_dirty(nodes[order[index]].previous);
+   if (nodes[order[index]].drawable==true) this->merge_dirty(nodes[order[index]].box);
+  }
+
+ }
+ if (full==true)
+ {
+  dirty_used=false;
+  this->merge_dirty(this->get_screen_box());
  }
 
 }
 
-void Background::slow_draw_background()
+void Display_List::expand_dirty()
 {
- unsigned long int x,y,index;
- x=0;
- y=0;
- for (index=maximum_width*maximum_height;index>0;--index)
+ unsigned long int index;
+ bool changed;
+ changed=dirty_used;
+ while (changed==true)
  {
-  this->draw_image_pixel(this->get_offset(start,x,y),x,y);
-  ++x;
-  if (x==maximum_width)
+  changed=false;
+  for (index=0;index<ordered;++index)
   {
-   x=0;
-   ++y;
+   if ((nodes[order[index]].drawable==false)||(nodes[order[index]].kind==BACKGROUND_NODE)) continue;
+   if (this->check_overlap(nodes[order[index]].box,dirty)==false) continue;
+   if (this->check_inside(nodes[order[index]].box,dirty)==false)
+   {
+    this->merge_dirty(nodes[order[index]].box);
+    changed=true;
+   }
+
   }
 
  }
 
 }
 
-void Background::configure_background()
+void Display_List::draw_base()
+{
+ unsigned long int index;
+ Background *target;
+ target=NULL;
+ for (index=0;index<ordered;++index)
+ {
+  if ((nodes[order[index]].kind==BACKGROUND_NODE)&&(nodes[order[index]].drawable==true)) target=nodes[order[index]].background;
+ }
+ if ((full==true)&&(target!=NULL))
+ {
+  target->draw_background();
+ }
+ else
+ {
+  surface->restore(dirty.x,dirty.y,dirty.width,dirty.height);
+ }
+
+}
+
+void Display_List::draw_node(const Display_Node &node)
 {
- switch(current_kind)
+ switch (node.kind)
  {
-  case NORMAL_BACKGROUND:
-  background_width=this->get_image_width();
-  background_height=this->get_image_height();
-  start=0;
+  case SPRITE_NODE:
+  node.sprite->draw_sprite();
   break;
-  case HORIZONTAL_BACKGROUND:
-  background_width=this->get_image_width()/this->get_frames();
-  background_height=this->get_image_height();
-  start=(this->get_frame()-1)*background_width;
+  case TILE_NODE:
+  node.tileset->draw_tile(node.row,node.column,node.x,node.y);
   break;
-  case VERTICAL_BACKGROUND:
-  background_width=this->get_image_width();
-  background_height=this->get_image_height()/this->get_frames();
-  start=(this->get_frame()-1)*background_width*background_height;
+  case BACKGROUND_NODE:
+  break;
+  case EMPTY_NODE:
   break;
  }
 
 }
 
-unsigned long int Background::get_width() const
+void Display_List::store_state()
 {
- return background_width;
+ unsigned long int index;
+ for (index=0;index<ordered;++index)
+ {
+  nodes[order[index]].drawn=nodes[order[index]].drawable;
+  nodes[order[index]].previous=nodes[order[index]].box;
+  nodes[order[index]].previous_frame=nodes[order[index]].frame;
+  nodes[order[index]].previous_state=nodes[order[index]].state;
+ }
+ dirty_used=false;
+ full=false;
 }
 
-unsigned long int Background::get_height() const
+void Display_List::initialize(Frame *target)
 {
- return background_height;
+ surface=target;
+ full=true;
 }
 
-void Background::set_kind(const BACKGROUND_TYPE kind)
+unsigned long int Display_List::add_sprite(Sprite *target,const unsigned long int layer)
 {
- current_kind=kind;
- this->configure_background();
- this->get_maximum_width();
- this->get_maximum_height();
+ unsigned long int index;
+ index=this->get_free_node();
+ nodes[index].kind=SPRITE_NODE;
+ nodes[index].sprite=target;
+ nodes[index].layer=layer;
+ return index;
 }
 
-void Background::set_setting(const BACKGROUND_TYPE kind,const unsigned long int frames)
+unsigned long int Display_List::add_tile(Tileset *target,const unsigned long int row,const unsigned long int column,const unsigned long int x,const unsigned long int y,const unsigned long int layer)
 {
- if (kind!=NORMAL_BACKGROUND) this->set_frames(frames);
- this->set_kind(kind);
+ unsigned long int index;
+ index=this->get_free_node();
+ nodes[index].kind=TILE_NODE;
+ nodes[index].tileset=target;
+ nodes[index].row=row;
+ nodes[index].column=column;
+ nodes[index].x=x;
+ nodes[index].y=y;
+ nodes[index].layer=layer;
+ return index;
 }
 
-void Background::set_target(const unsigned long int target)
+unsigned long int Display_List::add_background(Background *target,const unsigned long int layer)
 {
- this->set_frame(target);
- this->set_kind(current_kind);
+ unsigned long int index;
+ index=this->get_free_node();
+ nodes[index].kind=BACKGROUND_NODE;
+ nodes[index].background=target;
+ nodes[index].layer=layer;
+ return index;
 }
 
-void Background::step()
+void Display_List::remove_node(const unsigned long int index)
 {
- this->increase_frame();
- this->set_kind(current_kind);
+ if (index<amount)
+ {
+  if (nodes[index].drawn==true)
+  {
+   if (nodes[index].kind==BACKGROUND_NODE)
+   {
+    full=true;
+   }
+   else
+   {
+    this->merge_dirty(nodes[index].previous);
+   }
+
+  }
+  nodes[index].kind=EMPTY_NODE;
+ }
+
 }
 
-void Background::draw_background()
+void Display_List::set_layer(const unsigned long int index,const unsigned long int layer)
 {
- if (current!=this->get_frame())
+ if (index<amount)
  {
-  this->slow_draw_background();
-  this->save();
-  current=this->get_frame();
+  if ((nodes[index].layer!=layer)&&(nodes[index].drawn==true)) this->merge_dirty(nodes[index].previous);
+  nodes[index].layer=layer;
  }
- else
+
+}
+
+void Display_List::set_visible(const unsigned long int index,const bool enabled)
+{
+ if (index<amount) nodes[index].visible=enabled;
+}
+
+void Display_List::set_tile_position(const unsigned long int index,const unsigned long int x,const unsigned long int y)
+{
+ if (index<amount)
  {
-  this->restore();
+  nodes[index].x=x;
+  nodes[index].y=y;
  }
 
 }
 
-Sprite::Sprite()
+bool Display_List::get_visible(const unsigned long int index) const
 {
- transparent=true;
- current_x=0;
- current_y=0;
- sprite_width=0;
- sprite_height=0;
- current_kind=SINGLE_SPRITE;
+ bool result;
+ result=false;
+ if (index<amount) result=(nodes[index].kind!=EMPTY_NODE)&&(nodes[index].visible==true);
+ return result;
 }
 
-Sprite::~Sprite()
+bool Display_List::is_drawn(const unsigned long int index) const
 {
-
+ bool result;
+ result=false;
+ if (index<amount) result=(nodes[index].kind!=EMPTY_NODE)&&(nodes[index].drawn==true);
+ return result;
 }
 
-void Sprite::draw_transparent_sprite()
+unsigned long int Display_List::get_amount() const
 {
- unsigned long int x,y,index;
- x=0;
- y=0;
- for (index=sprite_width*sprite_height;index>0;--index)
+ unsigned long int index,result;
+ result=0;
+ for (index=0;index<amount;++index)
  {
-  if (this->compare_pixels(0,this->get_offset(start,x,y))==true)
-  {
-   this->draw_image_pixel(this->get_offset(start,x,y),x+current_x,y+current_y);
-  }
-  ++x;
-  if (x==sprite_width)
-  {
-   x=0;
-   ++y;
-  }
-
+  if (nodes[index].kind!=EMPTY_NODE) ++result;
  }
+ return result;
+}
 
+void Display_List::invalidate()
+{
+ full=true;
 }
 
-void Sprite::draw_normal_sprite()
+void Display_List::draw()
 {
- unsigned long int x,y,index;
- x=0;
- y=0;
- for (index=sprite_width*sprite_height;index>0;--index)
+ unsigned long int index;
+ if (surface!=NULL)
  {
-  this->draw_image_pixel(this->get_offset(start,x,y),x+current_x,y+current_y);
-  ++x;
-  if (x==sprite_width)
+  this->sort_nodes();
+  for (index=0;index<ordered;++index)
   {
-   x=0;
-   ++y;
+   this->prepare_node(nodes[order[index]]);
   }
+  this->find_occlusion();
+  this->find_dirty();
+  this->expand_dirty();
+  if (dirty_used==true)
+  {
+   this->draw_base();
+   for (index=0;index<ordered;++index)
+   {
+    if ((nodes[order[index]].drawable==true)&&(this->check_overlap(nodes[order[index]].box,dirty)==true)) this->draw_node(nodes[order[index]]);
+   }
 
+  }
+  this->store_state();
  }
 
 }
 
-void Sprite::load_sprite(Image &buffer,const SPRITE_TYPE kind,const unsigned long int frames)
-{
- this->load_image(buffer);
- if (kind!=SINGLE_SPRITE) this->set_frames(frames);
- this->set_kind(kind);
-}
-
-void Sprite::set_transparent(const bool enabled)
+Asset_Pack::Asset_Pack()
 {
- transparent=enabled;
+ target=-1;
+ data=NULL;
+ length=0;
+ entries=NULL;
+ amount=0;
 }
 
-bool Sprite::get_transparent() const
+Asset_Pack::~Asset_Pack()
 {
- return transparent;
+ this->close();
 }
 
-void Sprite::set_x(const unsigned long int x)
+void Asset_Pack::check_entry(const Pack_Entry &entry) const
 {
- current_x=x;
-}
+ size_t size;
+ if (memchr(entry.name,0,sizeof(entry.name))==NULL)
+ {
+  Halt("Invalid asset pack");
+ }
+ if ((entry.width==0)||(entry.height==0)||(entry.kind>TILESET_ASSET)||(entry.setting>2))
+ {
+  Halt("Invalid asset pack");
+ }
+ if ((entry.kind==TILESET_ASSET)&&((entry.rows==0)||(entry.columns==0)))
+ {
+  Halt("Invalid asset pack");
+ }
+ if ((entry.kind==SPRITE_ASSET)||(entry.kind==BACKGROUND_ASSET))
+ {
+  if ((entry.setting!=0)&&(entry.frames==0))
+  {
+   Halt("Invalid asset pack");
+  }
 
-void Sprite::set_y(const unsigned long int y)
-{
- current_y=y;
-}
+ }
+ size=static_cast<size_t>(entry.width)*static_cast<size_t>(entry.height);
+ if ((size/entry.width)!=entry.height)
+ {
+  Halt("Invalid asset pack");
+ }
+ if ((entry.offset%sizeof(unsigned short int))!=0)
+ {
+  Halt("Invalid asset pack");
+ }
+ if ((entry.offset>length)||(size>(length-entry.offset)/sizeof(unsigned short int)))
+ {
+  Halt("Invalid asset pack");
+ }
 
-void Sprite::increase_x()
-{
- ++current_x;
 }
 
-void Sprite::decrease_x()
+void Asset_Pack::check_pack()
 {
- --current_x;
-}
+ const Pack_head *head;
+ unsigned long int index;
+ if (length<sizeof(Pack_head))
+ {
+  Halt("Invalid asset pack");
+ }
+ head=reinterpret_cast<const Pack_head*>(data);
+ if (strncmp(head->signature,"GPAK",4)!=0)
+ {
+  Halt("Invalid asset pack");
+ }
+ if ((head->index>length)||(head->amount>(length-head->index)/sizeof(Pack_Entry)))
+ {
+  Halt("Invalid asset pack");
+ }
+ if ((head->index%4)!=0)
+ {
+  Halt("Invalid asset pack");
+ }
+ amount=head->amount;
+ entries=reinterpret_cast<const Pack_Entry*>(data+head->index);
+ for (index=0;index<amount;++index)
+ {
+  this->check_entry(entries[index]);
+ }
 
-void Sprite::increase_y()
-{
- ++current_y;
 }
 
-void Sprite::decrease_y()
+void Asset_Pack::open(const char *name)
 {
- --current_y;
+ struct stat information;
+ void *mapping;
+ this->close();
+ target=::open(name,O_RDONLY);
+ if (target==-1)
+ {
+  Halt("Can't open the asset pack");
+ }
+ if (fstat(target,&information)==-1)
+ {
+  Halt("Can't read the asset pack");
+ }
+ length=information.st_size;
+ if (length==0)
+ {
+  Halt("Invalid asset pack");
+ }
+ mapping=mmap(NULL,length,PROT_READ|PROT_WRITE,MAP_PRIVATE,target,0);
+ if (mapping==MAP_FAILED)
+ {
+  Halt("Can't map the asset pack");
+ }
+ data=static_cast<unsigned char*>(mapping);
+ this->check_pack();
 }
 
-void Sprite::increase_x(const unsigned long int increment)
+void Asset_Pack::close()
 {
- current_x+=increment;
+ if (data!=NULL)
+ {
+  munmap(data,length);
+  data=NULL;
+ }
+ if (target!=-1)
+ {
+  ::close(target);
+  target=-1;
+ }
+ length=0;
+ entries=NULL;
+ amount=0;
 }
 
-void Sprite::decrease_x(const unsigned long int decrement)
+unsigned long int Asset_Pack::get_amount() const
 {
- current_x-=decrement;
+ return amount;
 }
 
-void Sprite::increase_y(const unsigned long int increment)
+bool Asset_Pack::check_asset(const char *name) const
 {
- current_y+=increment;
-}
+ unsigned long int index;
+ bool result;
+ result=false;
+ for (index=0;index<amount;++index)
+ {
+  if (strcmp(entries[index].name,name)==0)
+  {
+   result=true;
+   break;
+  }
 
-void Sprite::decrease_y(const unsigned long int decrement)
-{
- current_y-=decrement;
+ }
+ return result;
 }
 
-unsigned long int Sprite::get_x() const
+const Pack_Entry *Asset_Pack::get_asset(const unsigned long int index) const
 {
- return current_x;
+ if (index>=amount)
+ {
+  Halt("Can't find the asset");
+ }
+ return entries+index;
 }
 
-unsigned long int Sprite::get_y() const
+const Pack_Entry *Asset_Pack::get_asset(const char *name) const
 {
- return current_y;
+ unsigned long int index;
+ for (index=0;index<amount;++index)
+ {
+  if (strcmp(entries[index].name,name)==0) break;
+ }
+ return this->get_asset(index);
 }
 
-unsigned long int Sprite::get_width() const
+unsigned short int *Asset_Pack::get_pixels(const Pack_Entry *asset)
 {
- return sprite_width;
+ return reinterpret_cast<unsigned short int*>(data+asset->offset);
 }
 
-unsigned long int Sprite::get_height() const
+Asset_Packer::Asset_Packer()
 {
- return sprite_height;
+ memset(&head,0,sizeof(Pack_head));
+ entries=NULL;
+ capacity=0;
 }
 
-Sprite* Sprite::get_handle()
+Asset_Packer::~Asset_Packer()
 {
- return this;
+ if (entries!=NULL) delete[] entries;
 }
 
-Collision_Box Sprite::get_box() const
+void Asset_Packer::resize_index()
 {
- Collision_Box target;
- target.x=current_x;
- target.y=current_y;
- target.width=sprite_width;
- target.height=sprite_height;
- return target;
+ Pack_Entry *index;
+ unsigned long int amount;
+ index=NULL;
+ amount=16;
+ if (capacity>0) amount=capacity*2;
+ try
+ {
+  index=new Pack_Entry[amount];
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for asset index");
+ }
+ if (entries!=NULL)
+ {
+  memcpy(index,entries,static_cast<size_t>(head.amount)*sizeof(Pack_Entry));
+  delete[] entries;
+ }
+ entries=index;
+ capacity=amount;
 }
 
-void Sprite::set_kind(const SPRITE_TYPE kind)
+void Asset_Packer::write_pixels(Image &source)
 {
- switch(kind)
+ unsigned short int *row;
+ const unsigned char *data;
+ const unsigned char *palette;
+ const unsigned char *color;
+ unsigned long int x,y;
+ size_t position;
+ row=NULL;
+ try
  {
-  case SINGLE_SPRITE:
-  sprite_width=this->get_image_width();
-  sprite_height=this->get_image_height();
-  start=0;
-  break;
-  case HORIZONTAL_STRIP:
-  sprite_width=this->get_image_width()/this->get_frames();
-  sprite_height=this->get_image_height();
-  start=(this->get_frame()-1)*sprite_width;
-  break;
-  case VERTICAL_STRIP:
-  sprite_width=this->get_image_width();
-  sprite_height=this->get_image_height()/this->get_frames();
-  start=(this->get_frame()-1)*sprite_width*sprite_height;
-  break;
+  row=new unsigned short int[source.get_width()];
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for image row");
+ }
+ data=source.get_data();
+ palette=source.get_palette();
+ position=0;
+ for (y=0;y<source.get_height();++y)
+ {
+  for (x=0;x<source.get_width();++x)
+  {
+   if (source.get_type()==INDEXED_IMAGE) color=palette+3*static_cast<size_t>(data[position]); else color=data+3*position;
+   row[x]=(color[0] >> 3)+((color[1] >> 2) << 5)+((color[2] >> 3) << 11); // This code bases on code from SVGALib
+   ++position;
+  }
+  output.write(row,static_cast<size_t>(source.get_width())*sizeof(unsigned short int));
  }
- current_kind=kind;
+ delete[] row;
 }
 
-SPRITE_TYPE Sprite::get_kind() const
+void Asset_Packer::add_asset(const char *name,Image &source,const ASSET_TYPE kind,const unsigned long int frames,const unsigned long int setting,const unsigned long int rows,const unsigned long int columns)
 {
- return current_kind;
+ Pack_Entry *entry;
+ if (strlen(name)>=sizeof(entry->name))
+ {
+  Halt("The asset name is too long");
+ }
+ if ((source.get_width()==0)||(source.get_height()==0))
+ {
+  Halt("The asset image is empty");
+ }
+ if (head.amount==capacity) this->resize_index();
+ entry=entries+head.amount;
+ memset(entry,0,sizeof(Pack_Entry));
+ strcpy(entry->name,name);
+ entry->kind=kind;
+ entry->width=source.get_width();
+ entry->height=source.get_height();
+ entry->frames=frames;
+ entry->setting=setting;
+ entry->rows=rows;
+ entry->columns=columns;
+ entry->offset=head.index;
+ this->write_pixels(source);
+ head.index+=static_cast<size_t>(entry->width)*static_cast<size_t>(entry->height)*sizeof(unsigned short int);
+ ++head.amount;
 }
 
-void Sprite::set_target(const unsigned long int target)
+void Asset_Packer::create_pack(const char *name)
 {
- this->set_frame(target);
- this->set_kind(current_kind);
+ memset(&head,0,sizeof(Pack_head));
+ memcpy(head.signature,"GPAK",4);
+ head.index=sizeof(Pack_head);
+ output.open(name);
+ output.write(&head,sizeof(Pack_head));
 }
 
-void Sprite::step()
+void Asset_Packer::add_image(const char *name,Image &source)
 {
- this->increase_frame();
- this->set_kind(current_kind);
+ this->add_asset(name,source,IMAGE_ASSET,1,0,1,1);
 }
 
-void Sprite::set_position(const unsigned long int x,const unsigned long int y)
+void Asset_Packer::add_sprite(const char *name,Image &source,const SPRITE_TYPE kind,const unsigned long int frames)
 {
- current_x=x;
- current_y=y;
+ if ((kind!=SINGLE_SPRITE)&&(frames==0))
+ {
+  Halt("Invalid amount of frames");
+ }
+ this->add_asset(name,source,SPRITE_ASSET,frames,kind,1,1);
 }
 
-void Sprite::clone(Sprite &target)
+void Asset_Packer::add_background(const char *name,Image &source,const BACKGROUND_TYPE kind,const unsigned long int frames)
 {
- this->set_size(target.get_image_width(),target.get_image_height());
- this->set_frames(target.get_frames());
- this->set_kind(target.get_kind());
- this->set_transparent(target.get_transparent());
- this->set_buffer(this->create_buffer(target.get_image_width(),target.get_image_width()));
- memmove(this->get_image(),target.get_image(),target.get_length());
+ if ((kind!=NORMAL_BACKGROUND)&&(frames==0))
+ {
+  Halt("Invalid amount of frames");
+ }
+ this->add_asset(name,source,BACKGROUND_ASSET,frames,kind,1,1);
 }
 
-void Sprite::draw_sprite()
+void Asset_Packer::add_tileset(const char *name,Image &source,const unsigned long int row_amount,const unsigned long int column_amount)
 {
- if (transparent==true)
- {
-  this->draw_transparent_sprite();
- }
- else
+ if ((row_amount==0)||(column_amount==0))
  {
-  this->draw_normal_sprite();
+  Halt("Invalid tileset size");
  }
-
+ this->add_asset(name,source,TILESET_ASSET,1,0,row_amount,column_amount);
 }
 
-void Sprite::draw_sprite(const unsigned long int x,const unsigned long int y)
+void Asset_Packer::finish_pack()
 {
- this->set_position(x,y);
- this->draw_sprite();
+ unsigned char padding[4];
+ size_t amount;
+ memset(padding,0,4);
+ amount=(4-head.index%4)%4;
+ if (amount>0) output.write(padding,amount);
+ head.index+=amount;
+ if (head.amount>0) output.write(entries,static_cast<size_t>(head.amount)*sizeof(Pack_Entry));
+ output.set_position(0);
+ output.write(&head,sizeof(Pack_head));
+ output.close();
 }
 
-void Sprite::draw_sprite(const bool transparency)
+unsigned long int Asset_Packer::get_amount() const
 {
- this->set_transparent(transparency);
- this->draw_sprite();
+ return head.amount;
 }
 
-void Sprite::draw_sprite(const bool transparency,const unsigned long int x,const unsigned long int y)
+Async_Loader::Async_Loader()
 {
- this->set_transparent(transparency);
- this->draw_sprite(x,y);
+ jobs=NULL;
+ amount=0;
+ sequence=0;
+ callback=NULL;
+ callback_data=NULL;
+ loaders=NULL;
+ workers=0;
+ running=false;
 }
 
-Tileset::Tileset()
+Async_Loader::~Async_Loader()
 {
- offset=0;
- rows=0;
- columns=0;
- tile_width=0;
- tile_height=0;
+ unsigned long int index;
+ if (running==true)
+ {
+  pthread_mutex_lock(&lock);
+  running=false;
+  pthread_cond_broadcast(&signal);
+  pthread_mutex_unlock(&lock);
+  for (index=0;index<workers;++index)
+  {
+   pthread_join(loaders[index],NULL);
+  }
+  delete[] loaders;
+  loaders=NULL;
+  pthread_cond_destroy(&finished);
+  pthread_cond_destroy(&signal);
+  pthread_mutex_destroy(&lock);
+ }
+ if (jobs!=NULL)
+ {
+  for (index=0;index<amount;++index)
+  {
+   this->clear_job(jobs[index]);
+  }
+  delete[] jobs;
+  jobs=NULL;
+ }
+
 }
 
-Tileset::~Tileset()
+void Async_Loader::start_loader()
 {
+ unsigned long int index;
+ if (workers==0)
+ {
+  workers=1;
+  if (get_nprocs()>1) workers=get_nprocs();
+ }
+ try
+ {
+  loaders=new pthread_t[workers];
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for asset loader");
+ }
+ pthread_mutex_init(&lock,NULL);
+ pthread_cond_init(&signal,NULL);
+ pthread_cond_init(&finished,NULL);
+ running=true;
+ for (index=0;index<workers;++index)
+ {
+  if (pthread_create(loaders+index,NULL,load_assets,this)!=0)
+  {
+   Halt("Can't start asset loader");
+  }
 
-}
+ }
 
-unsigned long int Tileset::get_tile_width() const
-{
- return tile_width;
 }
 
-unsigned long int Tileset::get_tile_height() const
+void Async_Loader::resize_jobs()
 {
- return tile_height;
-}
+ Load_Job *target;
+ unsigned long int index,length;
+ length=amount+16;
+ target=NULL;
+ try
+ {
+  target=new Load_Job[length];
+ }
+ catch (...)
+ {
+  Halt("Can't allocate memory for load jobs");
+ }
+ for (index=0;index<length;++index)
+ {
+  if (index<amount)
+  {
+   target[index]=jobs[index];
+  }
+  else
+  {
+   target[index].name=NULL;
+   target[index].surface=NULL;
+   target[index].audio=NULL;
+   target[index].state=EMPTY_LOAD;
+  }
 
-unsigned long int Tileset::get_rows() const
-{
- return rows;
+ }
+ if (jobs!=NULL) delete[] jobs;
+ jobs=target;
+ amount=length;
 }
 
-unsigned long int Tileset::get_columns() const
+unsigned long int Async_Loader::get_free_job()
 {
- return columns;
+ unsigned long int index;
+ for (index=0;index<amount;++index)
+ {
+  if (jobs[index].state==EMPTY_LOAD) break;
+ }
+ if (index==amount) this->resize_jobs();
+ return index;
 }
 
-void Tileset::select_tile(const unsigned long int row,const unsigned long int column)
+unsigned long int Async_Loader::add_job(const char *name,const LOAD_TYPE kind,const unsigned long int width,const unsigned long int height)
 {
- if ((row<rows)&&(column<columns))
+ unsigned long int index;
+ char *target;
+ Surface *surface;
+ Audio *audio;
+ target=NULL;
+ surface=NULL;
+ audio=NULL;
+ if (running==false) this->start_loader();
+ try
  {
-  offset=this->get_offset(0,row*tile_width,column*tile_height);
+  target=new char[strlen(name)+1];
+  if (kind==WAVE_LOAD) audio=new Audio; else surface=new Surface;
  }
-
+ catch (...)
+ {
+  Halt("Can't allocate memory for load job");
+ }
+ strcpy(target,name);
+ pthread_mutex_lock(&lock);
+ index=this->get_free_job();
+ jobs[index].name=target;
+ jobs[index].surface=surface;
+ jobs[index].audio=audio;
+ jobs[index].kind=kind;
+ jobs[index].width=width;
+ jobs[index].height=height;
+ jobs[index].order=sequence;
+ jobs[index].time=0;
+ jobs[index].notified=false;
+ jobs[index].state=WAITING_LOAD;
+ ++sequence;
+ pthread_cond_signal(&signal);
+ pthread_mutex_unlock(&lock);
+ return index;
+}
+
+void Async_Loader::clear_job(Load_Job &job)
+{
+ if (job.name!=NULL)
+ {
+  delete[] job.name;
+  job.name=NULL;
+ }
+ if (job.surface!=NULL)
+ {
+  delete job.surface;
+  job.surface=NULL;
+ }
+ if (job.audio!=NULL)
+ {
+  delete job.audio;
+  job.audio=NULL;
+ }
+ job.state=EMPTY_LOAD;
 }
 
-void Tileset::draw_tile(const unsigned long int x,const unsigned long int y)
+void Async_Loader::check_index(const unsigned long int index) const
 {
- unsigned long int tile_x,tile_y,index;
- tile_x=0;
- tile_y=0;
- for (index=tile_width*tile_height;index>0;--index)
+ if (index>=amount)
  {
-  this->draw_image_pixel(offset+this->get_offset(0,tile_x,tile_y),x+tile_x,y+tile_y);
-  ++tile_x;
-  if (tile_x==tile_width)
-  {
-   tile_x=0;
-   ++tile_y;
-  }
-
+  Halt("Invalid load job");
  }
 
 }
 
-void Tileset::draw_tile(const unsigned long int row,const unsigned long int column,const unsigned long int x,const unsigned long int y)
+unsigned long int Async_Loader::get_clock() const
 {
- this->select_tile(row,column);
- this->draw_tile(x,y);
+ timeval current;
+ gettimeofday(&current,NULL);
+ return static_cast<unsigned long int>(current.tv_sec)*1000000UL+static_cast<unsigned long int>(current.tv_usec);
 }
 
-void Tileset::load_tileset(Image &buffer,const unsigned long int row_amount,const unsigned long int column_amount)
+void Async_Loader::wait_job(const unsigned long int index)
 {
- if ((row_amount>0)&&(column_amount>0))
+ LOAD_STATE state;
+ this->check_index(index);
+ pthread_mutex_lock(&lock);
+ while ((jobs[index].state==WAITING_LOAD)||(jobs[index].state==ACTIVE_LOAD))
  {
-  this->load_image(buffer);
-  rows=row_amount;
-  columns=column_amount;
-  tile_width=this->get_image_width()/rows;
-  tile_height=this->get_image_height()/columns;
+  pthread_cond_wait(&finished,&lock);
+ }
+ state=jobs[index].state;
+ pthread_mutex_unlock(&lock);
+ if (state==EMPTY_LOAD)
+ {
+  Halt("Invalid load job");
  }
 
 }
 
-Text::Text()
+void Async_Loader::set_callback(LOAD_CALLBACK target,void *data)
 {
- current_x=0;
- current_y=0;
- font=NULL;
+ callback=target;
+ callback_data=data;
 }
 
-Text::~Text()
+void Async_Loader::set_workers(const unsigned long int amount)
 {
+ if (running==false) workers=amount;
+}
 
+unsigned long int Async_Loader::get_workers() const
+{
+ return workers;
 }
 
-void Text::increase_position()
+unsigned long int Async_Loader::load_tga(const char *name)
 {
- font->increase_x(font->get_width());
+ return this->add_job(name,TGA_LOAD,0,0);
 }
 
-void Text::restore_position()
+unsigned long int Async_Loader::load_pcx(const char *name)
 {
- font->set_position(current_x,current_y);
+ return this->add_job(name,PCX_LOAD,0,0);
 }
 
-void Text::set_position(const unsigned long int x,const unsigned long int y)
+unsigned long int Async_Loader::load_tga(const char *name,const unsigned long int target_width,const unsigned long int target_height)
 {
- font->set_position(x,y);
- current_x=x;
- current_y=y;
+ return this->add_job(name,TGA_LOAD,target_width,target_height);
 }
 
-void Text::load_font(Sprite *target)
+unsigned long int Async_Loader::load_pcx(const char *name,const unsigned long int target_width,const unsigned long int target_height)
 {
- font=target;
- font->set_frames(128);
- font->set_kind(HORIZONTAL_STRIP);
+ return this->add_job(name,PCX_LOAD,target_width,target_height);
 }
 
-void Text::draw_character(const char target)
+unsigned long int Async_Loader::load_wave(const char *name)
 {
- font->set_target(static_cast<unsigned char>(target)+1);
- font->draw_sprite();
+ return this->add_job(name,WAVE_LOAD,0,0);
 }
 
-void Text::draw_text(const char *text)
+void Async_Loader::load_batch(const Load_Item *items,const unsigned long int item_amount,unsigned long int *indexes)
 {
- size_t index,length;
- length=strlen(text);
- this->restore_position();
- for (index=0;index<length;++index)
+ unsigned long int index,job;
+ for (index=0;index<item_amount;++index)
  {
-  if (text[index]<32) continue;
-  this->draw_character(text[index]);
-  this->increase_position();
+  job=this->add_job(items[index].name,items[index].kind,items[index].width,items[index].height);
+  if (indexes!=NULL) indexes[index]=job;
  }
 
 }
 
-void Text::draw_character(const unsigned long int x,const unsigned long int y,const char target)
+LOAD_STATE Async_Loader::get_state(const unsigned long int index)
 {
- this->set_position(x,y);
- this->draw_character(target);
+ LOAD_STATE state;
+ state=EMPTY_LOAD;
+ if ((running==true)&&(index<amount))
+ {
+  pthread_mutex_lock(&lock);
+  state=jobs[index].state;
+  pthread_mutex_unlock(&lock);
+ }
+ return state;
 }
 
-void Text::draw_text(const unsigned long int x,const unsigned long int y,const char *text)
+bool Async_Loader::is_ready(const unsigned long int index)
 {
- this->set_position(x,y);
- this->draw_text(text);
+ return this->get_state(index)==READY_LOAD;
 }
 
-Collision::Collision()
+unsigned long int Async_Loader::count_pending() const
 {
- first.x=0;
- first.y=0;
- first.width=0;
- first.height=0;
- second=first;
+ unsigned long int index,result;
+ result=0;
+ for (index=0;index<amount;++index)
+ {
+  if ((jobs[index].state==WAITING_LOAD)||(jobs[index].state==ACTIVE_LOAD)) ++result;
+ }
+ return result;
 }
 
-Collision::~Collision()
+unsigned long int Async_Loader::get_pending()
 {
-
+ unsigned long int result;
+ result=0;
+ if (running==true)
+ {
+  pthread_mutex_lock(&lock);
+  result=this->count_pending();
+  pthread_mutex_unlock(&lock);
+ }
+ return result;
 }
 
-void Collision::set_target(const Collision_Box &first_target,const Collision_Box &second_target)
+unsigned long int Async_Loader::get_load_time(const unsigned long int index)
 {
- first=first_target;
- second=second_target;
+ unsigned long int result;
+ result=0;
+ if ((running==true)&&(index<amount))
+ {
+  pthread_mutex_lock(&lock);
+  if (jobs[index].state==READY_LOAD) result=jobs[index].time;
+  pthread_mutex_unlock(&lock);
+ }
+ return result;
 }
 
-bool Collision::check_horizontal_collision() const
+void Async_Loader::print_report()
 {
- bool result;
- result=false;
- if ((first.x+first.width)>=second.x)
+ unsigned long int index,total;
+ total=0;
+ if (running==true)
  {
-  if (first.x<=(second.x+second.width)) result=true;
+  pthread_mutex_lock(&lock);
+  for (index=0;index<amount;++index)
+  {
+   if (jobs[index].state==READY_LOAD)
+   {
+    printf("%lu %s: %lu us\n",index,jobs[index].name,jobs[index].time);
+    total+=jobs[index].time;
+   }
+
+  }
+  pthread_mutex_unlock(&lock);
+  printf("Decoding time: %lu us on %lu workers\n",total,workers);
  }
- return result;
+
 }
 
-bool Collision::check_vertical_collision() const
+void Async_Loader::update()
 {
- bool result;
- result=false;
- if ((first.y+first.height)>=second.y)
+ unsigned long int index;
+ bool ready;
+ if (running==true)
  {
-  if (first.y<=(second.y+second.height)) result=true;
+  for (index=0;index<amount;++index)
+  {
+   pthread_mutex_lock(&lock);
+   ready=(jobs[index].state==READY_LOAD)&&(jobs[index].notified==false);
+   if (ready==true) jobs[index].notified=true;
+   pthread_mutex_unlock(&lock);
+   if ((ready==true)&&(callback!=NULL)) callback(index,callback_data);
+  }
+
  }
- return result;
+
 }
 
-bool Collision::check_collision() const
+void Async_Loader::wait_all()
 {
- return this->check_horizontal_collision() || this->check_vertical_collision();
+ if (running==true)
+ {
+  pthread_mutex_lock(&lock);
+  while (this->count_pending()>0)
+  {
+   pthread_cond_wait(&finished,&lock);
+  }
+  pthread_mutex_unlock(&lock);
+ }
+
 }
 
-bool Collision::check_horizontal_collision(const Collision_Box &first_target,const Collision_Box &second_target)
+void Async_Loader::take_surface(const unsigned long int index,Surface &target)
 {
- this->set_target(first_target,second_target);
- return this->check_horizontal_collision();
+ this->wait_job(index);
+ if (jobs[index].surface==NULL)
+ {
+  Halt("The load job doesn't contain an image");
+ }
+ target.swap_image(*jobs[index].surface);
+ pthread_mutex_lock(&lock);
+ this->clear_job(jobs[index]);
+ pthread_mutex_unlock(&lock);
 }
 
-bool Collision::check_vertical_collision(const Collision_Box &first_target,const Collision_Box &second_target)
+void Async_Loader::take_audio(const unsigned long int index,Audio &target)
 {
- this->set_target(first_target,second_target);
- return this->check_vertical_collision();
+ this->wait_job(index);
+ if (jobs[index].audio==NULL)
+ {
+  Halt("The load job doesn't contain audio");
+ }
+ target.swap_audio(*jobs[index].audio);
+ pthread_mutex_lock(&lock);
+ this->clear_job(jobs[index]);
+ pthread_mutex_unlock(&lock);
 }
 
-bool Collision::check_collision(const Collision_Box &first_target,const Collision_Box &second_target)
+void Async_Loader::cancel(const unsigned long int index)
 {
- this->set_target(first_target,second_target);
- return this->check_collision();
+ this->check_index(index);
+ pthread_mutex_lock(&lock);
+ while (jobs[index].state==ACTIVE_LOAD)
+ {
+  pthread_cond_wait(&finished,&lock);
+ }
+ this->clear_job(jobs[index]);
+ pthread_mutex_unlock(&lock);
 }
 
-Collision_Box Collision::generate_box(const unsigned long int x,const unsigned long int y,const unsigned long int width,const unsigned long int height) const
+void Async_Loader::load_jobs()
 {
- Collision_Box result;
- result.x=x;
- result.y=y;
- result.width=width;
- result.height=height;
- return result;
+ unsigned long int index,selected,start;
+ Load_Job job;
+ pthread_mutex_lock(&lock);
+ while (running==true)
+ {
+  selected=amount;
+  for (index=0;index<amount;++index)
+  {
+   if (jobs[index].state==WAITING_LOAD)
+   {
+    if ((selected==amount)||(jobs[index].order<jobs[selected].order)) selected=index;
+   }
+
+  }
+  if (selected==amount)
+  {
+   pthread_cond_wait(&signal,&lock);
+   continue;
+  }
+  jobs[selected].state=ACTIVE_LOAD;
+  job=jobs[selected];
+  pthread_mutex_unlock(&lock);
+  start=this->get_clock();
+  switch (job.kind)
+  {
+   case WAVE_LOAD:
+   job.audio->load_wave(job.name);
+   break;
+   case PCX_LOAD:
+   if ((job.width>0)&&(job.height>0)) job.surface->load_pcx(job.name,job.width,job.height); else job.surface->load_pcx(job.name);
+   break;
+   default:
+   if ((job.width>0)&&(job.height>0)) job.surface->load_tga(job.name,job.width,job.height); else job.surface->load_tga(job.name);
+   break;
+  }
+  start=this->get_clock()-start;
+  pthread_mutex_lock(&lock);
+  jobs[selected].time=start;
+  jobs[selected].state=READY_LOAD;
+  pthread_cond_broadcast(&finished);
+ }
+ pthread_mutex_unlock(&lock);
 }
 
 }
\ No newline at end of file
@@ -30,7 +30,10 @@ SVGALib homepage: http://www.svgalib.org
 #include <unistd.h>
 #include <pthread.h>
 #include <sys/sysinfo.h>
+#include <sys/time.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/soundcard.h>
 #include <linux/input.h>
 #include <linux/fb.h>
@@ -39,6 +42,13 @@ enum GAMEPAD_BUTTONS {BUTTON_UP=0,BUTTON_DOWN=1,BUTTON_LEFT=2,BUTTON_RIGHT=3,BUT
 enum MIRROR_TYPE {MIRROR_HORIZONTAL=0,MIRROR_VERTICAL=1};
 enum BACKGROUND_TYPE {NORMAL_BACKGROUND=0,HORIZONTAL_BACKGROUND=1,VERTICAL_BACKGROUND=2};
 enum SPRITE_TYPE {SINGLE_SPRITE=0,HORIZONTAL_STRIP=1,VERTICAL_STRIP=2};
+enum IMAGE_TYPE {TRUECOLOR_IMAGE=0,INDEXED_IMAGE=1};
+enum DECODE_TYPE {DECODE_HEAD=0,DECODE_IMAGE=1,DECODE_NATIVE=2,DECODE_INDEXES=3};
+enum NODE_TYPE {EMPTY_NODE=0,SPRITE_NODE=1,TILE_NODE=2,BACKGROUND_NODE=3};
+enum CHUNK_STATE {EMPTY_CHUNK=0,LOADING_CHUNK=1,READY_CHUNK=2};
+enum ASSET_TYPE {IMAGE_ASSET=0,SPRITE_ASSET=1,BACKGROUND_ASSET=2,TILESET_ASSET=3};
+enum LOAD_TYPE {TGA_LOAD=0,PCX_LOAD=1,WAVE_LOAD=2};
+enum LOAD_STATE {EMPTY_LOAD=0,WAITING_LOAD=1,ACTIVE_LOAD=2,READY_LOAD=3};
 
 struct WAVE_head
 {
@@ -89,6 +99,13 @@ struct TGA_image
  unsigned char direction:5;
 };
 
+struct RLE_State
+{
+ size_t left;
+ bool repeat;
+ unsigned char pixel[4];
+};
+
 struct PCX_head
 {
  unsigned char vendor:8;
@@ -111,6 +128,59 @@ struct PCX_head
  unsigned char filled[54];
 };
 
+struct Chunk_head
+{
+ char signature[4];
+ unsigned long int width:32;
+ unsigned long int height:32;
+ unsigned short int chunk_width:16;
+ unsigned short int chunk_height:16;
+};
+
+struct Pack_head
+{
+ char signature[4];
+ unsigned long int amount:32;
+ unsigned long int index:32;
+ unsigned long int reserved:32;
+};
+
+struct Pack_Entry
+{
+ char name[32];
+ unsigned long int kind:32;
+ unsigned long int width:32;
+ unsigned long int height:32;
+ unsigned long int frames:32;
+ unsigned long int setting:32;
+ unsigned long int rows:32;
+ unsigned long int columns:32;
+ unsigned long int offset:32;
+};
+
+struct LZ_head
+{
+ char signature[4];
+ unsigned long int length:32;
+ unsigned long int block:32;
+ unsigned long int amount:32;
+};
+
+struct LZ_Block
+{
+ unsigned long int offset:32;
+ unsigned long int length:32;
+};
+
+struct Chunk_Slot
+{
+ unsigned short int *pixels;
+ unsigned long int chunk;
+ unsigned long int used;
+ unsigned long int order;
+ CHUNK_STATE state;
+};
+
 struct Collision_Box
 {
  unsigned long int x;
@@ -119,12 +189,44 @@ struct Collision_Box
  unsigned long int height;
 };
 
+struct Texture_Vertex
+{
+ long int x;
+ long int y;
+ unsigned long int u;
+ unsigned long int v;
+};
+
+struct Affine_Line
+{
+ long int x;
+ long int y;
+ long int dx;
+ long int dy;
+};
+
+struct Load_Item
+{
+ const char *name;
+ LOAD_TYPE kind;
+ unsigned long int width;
+ unsigned long int height;
+};
+
+typedef void (*AFFINE_CALLBACK)(const unsigned long int line,Affine_Line &setting,void *data);
+typedef void (*RASTER_CALLBACK)(const unsigned long int line,unsigned short int *pixels,const unsigned long int width,void *data);
+typedef void (*LOAD_CALLBACK)(const unsigned long int index,void *data);
+
 namespace GOPHERGDK
 {
 
 void* oss_play_sound(void *buffer);
+void* stream_world_chunks(void *target);
+void* load_assets(void *target);
 void Halt(const char *message);
 
+class Asset_Pack;
+
 class Frame
 {
  private:
@@ -134,15 +236,43 @@ class Frame
  unsigned long int frame_height;
  unsigned short int *buffer;
  unsigned short int *shadow;
- void calculate_buffer_length();
+ unsigned char *indexes;
+ unsigned char *index_shadow;
+ unsigned char *inverse;
+ bool indexed;
+ bool inverse_changed;
+ bool effect_used;
+ unsigned long int revision;
+ unsigned long int crossfade_alpha;
+ unsigned short int palette[256];
+ unsigned short int effect_palette[256];
+ IMG_Pixel colors[256];
  unsigned short int *get_memory(const char *error);
  void clear_buffer(unsigned short int *target);
- unsigned short int *create_buffer(const char *error);
+ unsigned char *create_index_buffer(const char *error);
+ void set_default_palette();
+ long int get_distance(const long int red,const long int green,const long int blue,const unsigned short int index) const;
+ void find_nearest(const size_t color);
+ void build_inverse();
+ void update_inverse(const unsigned char index);
+ void rotate_inverse(const unsigned char first,const unsigned char last);
+ unsigned long int get_alpha(const unsigned char level) const;
+ unsigned long int expand_pixel(const unsigned short int pixel) const;
+ unsigned short int compact_pixel(const unsigned long int pixel) const;
+ unsigned short int *get_effect_palette();
+ void mix_color(unsigned short int *target,const size_t amount,const unsigned short int color,const unsigned long int alpha);
+ void mix_shadow(const unsigned long int alpha);
  protected:
+ void calculate_buffer_length();
+ unsigned short int *create_buffer(const char *error);
  size_t get_offset(const unsigned long int x,const unsigned long int y,const unsigned long int target_width);
  size_t get_offset(const unsigned long int x,const unsigned long int y) const;
  void set_size(const unsigned long int surface_width,const unsigned long int surface_height);
  void create_buffers();
+ void create_indexed_buffers();
+ void expand_indexes(unsigned short int *target,const size_t offset,const size_t amount);
+ void reset_effects();
+ unsigned short int *get_render_buffer();
  size_t get_length() const;
  public:
  Frame();
@@ -151,11 +281,25 @@ class Frame
  size_t get_pixels() const;
  unsigned long int get_frame_width() const;
  unsigned long int get_frame_height() const;
+ unsigned short int pack_pixel(const unsigned short int red,const unsigned short int green,const unsigned short int blue) const;
  bool draw_pixel(const unsigned long int x,const unsigned long int y,const unsigned short int red,const unsigned short int green,const unsigned short int blue);
+ bool draw_native_pixel(const unsigned long int x,const unsigned long int y,const unsigned short int color);
+ bool is_indexed() const;
+ unsigned char *get_indexes();
+ unsigned short int *get_palette();
+ bool draw_index(const unsigned long int x,const unsigned long int y,const unsigned char index);
+ unsigned char find_index(const unsigned char red,const unsigned char green,const unsigned char blue);
+ void set_palette_color(const unsigned char index,const unsigned char red,const unsigned char green,const unsigned char blue);
+ void rotate_palette(const unsigned char first,const unsigned char last);
  void clear_screen();
  void save();
  void restore();
  void restore(const unsigned long int x,const unsigned long int y,const unsigned long int width,const unsigned long int height);
+ void fade(const unsigned char red,const unsigned char green,const unsigned char blue,const unsigned char level);
+ void scale_brightness(const unsigned char level);
+ void crossfade(const unsigned char level);
+ unsigned long int get_revision() const;
+ void mark_changed();
 };
 
 class Plane: public Frame
@@ -167,6 +311,8 @@ class Plane: public Frame
  unsigned long int target_height;
  float x_ratio;
  float y_ratio;
+ protected:
+ void set_plane_size(const unsigned long int width,const unsigned long int height);
  public:
  Plane();
  ~Plane();
@@ -175,6 +321,56 @@ class Plane: public Frame
  Plane* get_handle();
 };
 
+class Dynamic_Plane:public Plane
+{
+ private:
+ unsigned long int maximum_width;
+ unsigned long int maximum_height;
+ unsigned long int minimum_width;
+ unsigned long int minimum_height;
+ unsigned long int level;
+ unsigned long int budget;
+ unsigned long int total;
+ unsigned long int frames;
+ timeval previous;
+ unsigned long int get_elapsed();
+ void apply_level();
+ void check_frame_time(const unsigned long int elapsed);
+ public:
+ Dynamic_Plane();
+ ~Dynamic_Plane();
+ void create_dynamic_plane(const unsigned long int width,const unsigned long int height,const unsigned long int surface_width,const unsigned long int surface_height,unsigned short int *surface_buffer);
+ void set_minimum(const unsigned long int width,const unsigned long int height);
+ void set_target_fps(const unsigned long int fps);
+ unsigned long int get_level() const;
+ void transfer();
+ Dynamic_Plane* get_handle();
+};
+
+class Layer:public Frame
+{
+ private:
+ bool visible;
+ bool forced;
+ unsigned short int key;
+ unsigned long int revision;
+ Collision_Box area;
+ void compose_area(unsigned short int *target);
+ void compose_full(unsigned short int *target);
+ public:
+ Layer();
+ ~Layer();
+ void create_layer(const unsigned long int width,const unsigned long int height);
+ void set_key(const unsigned char red,const unsigned char green,const unsigned char blue);
+ unsigned short int get_key() const;
+ void clear_layer();
+ void set_visible(const bool enabled);
+ bool get_visible() const;
+ bool is_changed() const;
+ void compose(unsigned short int *target);
+ Layer* get_handle();
+};
+
 class Timer
 {
  private:
@@ -208,10 +404,40 @@ class Render:public Frame
  unsigned long int start;
  fb_fix_screeninfo configuration;
  fb_var_screeninfo setting;
+ unsigned short int *present;
+ unsigned short int *band;
+ unsigned short int *expanded;
+ unsigned short int *stack;
+ unsigned short int *composed;
+ Layer **layers;
+ unsigned long int layer_amount;
+ unsigned long int stacked;
+ unsigned long int base_revision;
+ unsigned short int *window;
+ unsigned long int scroll_x;
+ unsigned long int scroll_y;
+ const long int *line_offsets;
+ const unsigned char *line_levels;
+ RASTER_CALLBACK line_hook;
+ void *hook_data;
+ unsigned short int red_levels[32];
+ unsigned short int green_levels[64];
+ unsigned short int blue_levels[32];
+ unsigned short int prepared_level;
  void read_base_configuration();
  void read_advanced_configuration();
  void read_configuration();
  void get_start_offset();
+ bool check_raster() const;
+ void shift_line(const unsigned short int *source,unsigned short int *target,const long int offset);
+ void prepare_levels(const unsigned char level);
+ void apply_level(unsigned short int *target,const unsigned char level);
+ void apply_raster(const unsigned short int *source_buffer,unsigned short int *target_buffer,const unsigned long int first,const unsigned long int amount);
+ void resize_layers();
+ unsigned short int *compose_layers(const unsigned short int *source);
+ void copy_piece(const unsigned short int *source,const unsigned long int x,const unsigned long int y,const unsigned long int target_x,const unsigned long int target_y,const unsigned long int width,const unsigned long int height);
+ unsigned short int *copy_window(const unsigned short int *source);
+ void present_indexes();
  protected:
  void prepare_render();
  void refresh();
@@ -221,6 +447,18 @@ class Render:public Frame
  unsigned long int get_width() const;
  unsigned long int get_height() const;
  unsigned long int get_color() const;
+ void set_raster_offsets(const long int *offsets);
+ void set_raster_levels(const unsigned char *levels);
+ void set_raster_hook(RASTER_CALLBACK hook,void *data);
+ void disable_raster();
+ void add_layer(Layer *target);
+ void remove_layer(Layer *target);
+ unsigned long int get_layer_amount() const;
+ bool is_scrolling() const;
+ void set_scroll(const long int x,const long int y);
+ unsigned long int get_scroll_x() const;
+ unsigned long int get_scroll_y() const;
+ Collision_Box get_view() const;
 };
 
 class Screen:public Render,public FPS
@@ -229,6 +467,8 @@ class Screen:public Render,public FPS
  Screen();
  ~Screen();
  void initialize();
+ void initialize_indexed();
+ void initialize_scrolling(const unsigned long int width,const unsigned long int height);
  void update();
  Screen* get_handle();
 };
@@ -402,11 +642,50 @@ class Binary_File
 
 class Input_File:public Binary_File
 {
+ private:
+ LZ_head head;
+ LZ_Block *blocks;
+ unsigned char *packed;
+ unsigned char *unpacked;
+ size_t unpacked_length;
+ unsigned long int current;
+ long int offset;
+ bool compressed;
+ void free_compression();
+ void check_compression();
+ bool decompress_block(const size_t length,const size_t target_length);
+ void load_block(const unsigned long int block);
+ protected:
+ size_t read_data(void *buffer,const size_t length);
  public:
  Input_File();
  ~Input_File();
  void open(const char *name);
+ void close();
  void read(void *buffer,const size_t length);
+ void set_position(const long int position);
+ long int get_position();
+ long int get_length();
+ bool is_compressed() const;
+ void swap_file(Input_File &source);
+};
+
+class Input_Stream:public Input_File
+{
+ private:
+ unsigned char buffer[4096];
+ size_t position;
+ size_t amount;
+ bool fill_buffer();
+ public:
+ Input_Stream();
+ ~Input_Stream();
+ void start_stream();
+ size_t get_available();
+ const unsigned char *get_current() const;
+ void skip_bytes(const size_t length);
+ bool read_byte(unsigned char &value);
+ bool read_block(void *block,const size_t length);
 };
 
 class Output_File:public Binary_File
@@ -420,6 +699,19 @@ class Output_File:public Binary_File
  void flush();
 };
 
+class LZ_Compressor
+{
+ private:
+ unsigned long int table[4096];
+ unsigned long int get_hash(const unsigned char *data) const;
+ unsigned char *write_length(unsigned char *output,size_t length) const;
+ public:
+ LZ_Compressor();
+ ~LZ_Compressor();
+ size_t compress(const unsigned char *input,const size_t length,unsigned char *output,const size_t capacity);
+ void compress_file(const char *source,const char *target);
+};
+
 class Audio
 {
  private:
@@ -444,6 +736,7 @@ class Audio
  void load_wave(const char *name);
  void read_data(void *buffer,const size_t length);
  void go_start();
+ void swap_audio(Audio &source);
 };
 
 class Player
@@ -472,11 +765,11 @@ class Primitive
 {
  private:
  IMG_Pixel color;
- Screen *surface;
+ Frame *surface;
  public:
  Primitive();
  ~Primitive();
- void initialize(Screen *screen);
+ void initialize(Frame *target);
  void set_color(const unsigned char red,const unsigned char green,const unsigned char blue);
  void draw_line(const unsigned long int x1,const unsigned long int y1,const unsigned long int x2,const unsigned long int y2);
  void draw_rectangle(const unsigned long int x,const unsigned long int y,const unsigned long int width,const unsigned long int height);
@@ -489,49 +782,125 @@ class Image
  unsigned long int width;
  unsigned long int height;
  unsigned char *data;
+ unsigned char *palette;
+ IMAGE_TYPE kind;
+ unsigned short int colors[256];
  unsigned char *create_buffer(const size_t length);
  void clear_buffer();
+ void create_palette();
+ void convert_palette(unsigned short int *target) const;
+ unsigned short int convert_pixel(const unsigned char *pixel) const;
+ void fill_pixels(unsigned char *target,const size_t depth,const size_t length) const;
+ void store_pixels(unsigned char *output,unsigned short int *native,const size_t index,const unsigned char *source,const size_t length,const size_t depth,const bool repeat) const;
+ void read_pixels(Input_Stream &target,unsigned char *output,unsigned short int *native,const size_t depth,const size_t length) const;
+ void decode_tga(Input_Stream &target,unsigned char *output,unsigned short int *native,const size_t depth,const size_t length) const;
+ void decode_tga_row(Input_Stream &target,RLE_State &state,unsigned char *row,const size_t depth,const size_t length) const;
+ void scale_row(const unsigned char *row,unsigned char *output,unsigned short int *native,const size_t depth,const unsigned long int source_width,const unsigned long int target_width) const;
+ void scale_tga(Input_Stream &target,const bool compressed,unsigned char *output,unsigned short int *native,const size_t depth,const unsigned long int source_width,const unsigned long int source_height);
+ void decode_pcx_row(Input_Stream &target,RLE_State &state,unsigned char *line,const size_t length) const;
+ void merge_planes(const unsigned char *line,unsigned char *row,const unsigned long int source_width,const size_t plane_length) const;
+ void read_pcx_palette(Input_File &target);
+ void check_output(const DECODE_TYPE mode,const size_t length) const;
+ void read_tga(const char *name,const DECODE_TYPE mode,void *output,const size_t length,const unsigned long int target_width,const unsigned long int target_height);
+ void read_pcx(const char *name,const DECODE_TYPE mode,void *output,const size_t length,const unsigned long int target_width,const unsigned long int target_height);
  public:
  Image();
  ~Image();
  void load_tga(const char *name);
  void load_pcx(const char *name);
+ void read_tga_head(const char *name);
+ void read_pcx_head(const char *name);
+ void load_tga(const char *name,unsigned short int *target,const size_t length);
+ void load_pcx(const char *name,unsigned short int *target,const size_t length);
+ void load_tga(const char *name,unsigned char *target,unsigned short int *target_palette,const size_t length);
+ void load_pcx(const char *name,unsigned char *target,unsigned short int *target_palette,const size_t length);
+ void load_tga(const char *name,const unsigned long int target_width,const unsigned long int target_height);
+ void load_tga(const char *name,unsigned short int *target,const size_t length,const unsigned long int target_width,const unsigned long int target_height);
+ void load_tga(const char *name,unsigned char *target,unsigned short int *target_palette,const size_t length,const unsigned long int target_width,const unsigned long int target_height);
+ void load_pcx(const char *name,const unsigned long int target_width,const unsigned long int target_height);
+ void load_pcx(const char *name,unsigned short int *target,const size_t length,const unsigned long int target_width,const unsigned long int target_height);
+ void load_pcx(const char *name,unsigned char *target,unsigned short int *target_palette,const size_t length,const unsigned long int target_width,const unsigned long int target_height);
  unsigned long int get_width() const;
  unsigned long int get_height() const;
  size_t get_length() const;
  unsigned char *get_data();
+ IMAGE_TYPE get_type() const;
+ unsigned char *get_palette();
  void destroy_image();
 };
 
 class Surface
 {
  private:
- Screen *surface;
+ Frame *surface;
  IMG_Pixel *image;
+ unsigned char *indexes;
+ unsigned short int *pixels;
+ const unsigned short int *current_palette;
  unsigned long int width;
  unsigned long int height;
+ unsigned long int revision;
+ bool borrowed;
+ unsigned short int palette[256];
+ void free_native();
+ void copy_pixel(IMG_Pixel *target_image,unsigned char *target_indexes,unsigned short int *target_pixels,const size_t location,const size_t position) const;
+ void replace_buffer(IMG_Pixel *target_image,unsigned char *target_indexes,unsigned short int *target_pixels);
+ void load_file(const char *name,const bool pcx,const unsigned long int target_width,const unsigned long int target_height);
  protected:
  void save();
  void restore();
+ void restore(const unsigned long int x,const unsigned long int y,const unsigned long int width,const unsigned long int height);
  void clear_buffer();
  IMG_Pixel *create_buffer(const unsigned long int image_width,const unsigned long int image_height);
+ unsigned char *create_index_buffer(const unsigned long int image_width,const unsigned long int image_height);
+ unsigned short int *create_native_buffer(const unsigned long int image_width,const unsigned long int image_height);
+ void set_native_buffer(unsigned short int *buffer);
  void set_size(const unsigned long int image_width,const unsigned long int image_height);
  void set_buffer(IMG_Pixel *buffer);
+ void set_index_buffer(unsigned char *buffer,const unsigned short int *colors);
+ const Pack_Entry *attach_asset(Asset_Pack &pack,const char *name);
  size_t get_offset(const unsigned long int start,const unsigned long int x,const unsigned long int y,const unsigned long int target_width);
  size_t get_offset(const unsigned long int start,const unsigned long int x,const unsigned long int y) const;
  void draw_image_pixel(const size_t offset,const unsigned long int x,const unsigned long int y);
  bool compare_pixels(const size_t first,const size_t second) const;
+ unsigned short int get_native_pixel(const size_t offset) const;
+ unsigned short int *get_surface_buffer();
+ unsigned char *get_surface_indexes();
+ bool check_key(const unsigned char pixel,const unsigned char key) const;
+ bool check_key(const unsigned short int pixel,const unsigned short int key) const;
+ bool check_key(const IMG_Pixel &pixel,const IMG_Pixel &key) const;
+ void convert_pixel(unsigned short int &target,const unsigned char pixel) const;
+ void convert_pixel(unsigned short int &target,const unsigned short int pixel) const;
+ void convert_pixel(unsigned short int &target,const IMG_Pixel &pixel) const;
+ void convert_pixel(unsigned char &target,const unsigned char pixel) const;
+ void convert_pixel(unsigned char &target,const unsigned short int pixel) const;
+ void convert_pixel(unsigned char &target,const IMG_Pixel &pixel) const;
+ bool check_indexed() const;
  unsigned long int get_surface_width() const;
  unsigned long int get_surface_height() const;
  public:
  Surface();
  ~Surface();
- void initialize(Screen *screen);
+ void initialize(Frame *target);
+ Frame* get_surface();
  size_t get_length() const;
  IMG_Pixel *get_image();
+ unsigned char *get_indexes();
+ unsigned short int *get_pixels();
+ unsigned short int *get_palette();
+ bool is_indexed() const;
+ bool is_native() const;
+ void set_palette(const unsigned short int *colors);
  void load_image(Image &buffer);
+ void load_tga(const char *name);
+ void load_pcx(const char *name);
+ void load_tga(const char *name,const unsigned long int target_width,const unsigned long int target_height);
+ void load_pcx(const char *name,const unsigned long int target_width,const unsigned long int target_height);
+ void load_asset(Asset_Pack &pack,const char *name);
+ void swap_image(Surface &source);
  unsigned long int get_image_width() const;
  unsigned long int get_image_height() const;
+ unsigned long int get_revision() const;
  void mirror_image(const MIRROR_TYPE kind);
  void resize_image(const unsigned long int new_width,const unsigned long int new_height);
  void horizontal_mirror();
@@ -568,6 +937,10 @@ class Background:public Surface,public Animation
  void get_maximum_height();
  void slow_draw_background();
  void configure_background();
+ long int wrap_coordinate(const long int value,const long int limit) const;
+ void check_affine_size() const;
+ template <typename source_type,typename target_type> void fill_affine_line(target_type *target,const source_type *source,const Affine_Line &setting);
+ void draw_affine_line(const unsigned long int line,const Affine_Line &setting);
  public:
  Background();
  ~Background();
@@ -578,25 +951,55 @@ class Background:public Surface,public Animation
  void set_target(const unsigned long int target);
  void step();
  void draw_background();
+ void draw_affine_background(const Affine_Line *lines);
+ void draw_affine_background(AFFINE_CALLBACK callback,void *data);
+ void copy_frame(unsigned short int *target) const;
+ void load_background(Asset_Pack &pack,const char *name);
 };
 
 class Sprite:public Surface,public Animation
 {
  private:
  bool transparent;
+ bool horizontal_flip;
+ bool vertical_flip;
+ bool drawn;
+ Collision_Box drawn_box;
  unsigned long int current_x;
  unsigned long int current_y;
  unsigned long int sprite_width;
  unsigned long int sprite_height;
  SPRITE_TYPE current_kind;
- void draw_transparent_sprite();
- void draw_normal_sprite();
+ Collision_Box *bounds;
+ unsigned long int bounds_amount;
+ unsigned long int bounds_width;
+ unsigned long int bounds_height;
+ unsigned long int bounds_revision;
+ SPRITE_TYPE bounds_kind;
+ void clear_bounds();
+ size_t get_frame_start(const unsigned long int target) const;
+ Collision_Box calculate_bound(const size_t frame_start) const;
+ void calculate_bounds();
+ void check_bounds();
+ Collision_Box get_bound();
+ Collision_Box get_placement(const Collision_Box &bound) const;
+ void remember_box(const Collision_Box &bound);
+ template <bool transparency,bool horizontal,bool vertical,typename source_type,typename target_type> void copy_rows(target_type *target,const source_type *source,const Collision_Box &bound,const unsigned long int stop_x,const unsigned long int stop_y);
+ template <bool transparency,bool horizontal,bool vertical,typename target_type> void select_source(target_type *target,const Collision_Box &bound,const unsigned long int stop_x,const unsigned long int stop_y);
+ template <bool transparency,bool horizontal,bool vertical,bool clipping> void draw_frame(const Collision_Box &bound);
+ template <bool transparency,bool horizontal,bool vertical> void select_clipping(const Collision_Box &bound);
+ template <bool transparency,bool horizontal> void select_vertical(const Collision_Box &bound);
+ template <bool transparency> void select_horizontal(const Collision_Box &bound);
  public:
  Sprite();
  ~Sprite();
  void load_sprite(Image &buffer,const SPRITE_TYPE kind,const unsigned long int frames);
+ void load_sprite(Asset_Pack &pack,const char *name);
  void set_transparent(const bool enabled);
  bool get_transparent() const;
+ void set_flip(const bool horizontal,const bool vertical);
+ bool get_horizontal_flip() const;
+ bool get_vertical_flip() const;
  void set_x(const unsigned long int x);
  void set_y(const unsigned long int y);
  void increase_x();
@@ -613,6 +1016,11 @@ class Sprite:public Surface,public Animation
  unsigned long int get_height() const;
  Sprite* get_handle();
  Collision_Box get_box() const;
+ Collision_Box get_trimmed_box();
+ void copy_frame(const unsigned long int target,unsigned short int *pixels,bool *opaque);
+ Collision_Box get_drawn_box() const;
+ bool is_drawn() const;
+ void erase();
  void set_kind(const SPRITE_TYPE kind);
  SPRITE_TYPE get_kind() const;
  void set_target(const unsigned long int target);
@@ -644,6 +1052,50 @@ class Tileset:public Surface
  void draw_tile(const unsigned long int x,const unsigned long int y);
  void draw_tile(const unsigned long int row,const unsigned long int column,const unsigned long int x,const unsigned long int y);
  void load_tileset(Image &buffer,const unsigned long int row_amount,const unsigned long int column_amount);
+ void load_tileset(Asset_Pack &pack,const char *name);
+};
+
+class Texture:public Surface
+{
+ private:
+ bool transparent;
+ float u_gradient;
+ float v_gradient;
+ long int u_step;
+ long int v_step;
+ long int get_slope(const long int start,const long int stop,const long int length) const;
+ bool calculate_gradients(const Texture_Vertex &first,const Texture_Vertex &second,const Texture_Vertex &third);
+ template <bool transparency,typename source_type,typename target_type> void fill_span(target_type *target,const source_type *source,const long int length,const long int u,const long int v);
+ template <bool transparency,typename target_type> void select_span(target_type *target,const long int length,const long int u,const long int v);
+ void draw_span(const long int y,const long int long_x,const long int short_x,const long int u,const long int v);
+ public:
+ Texture();
+ ~Texture();
+ void set_transparent(const bool enabled);
+ bool get_transparent() const;
+ Texture* get_handle();
+ void draw_triangle(const Texture_Vertex &first,const Texture_Vertex &second,const Texture_Vertex &third);
+ void draw_quad(const Texture_Vertex &first,const Texture_Vertex &second,const Texture_Vertex &third,const Texture_Vertex &fourth);
+};
+
+struct Glyph
+{
+ size_t pixels;
+ size_t spans;
+ unsigned long int span_amount;
+ unsigned long int left;
+ unsigned long int width;
+};
+
+struct Text_Cache
+{
+ char *text;
+ unsigned short int *pixels;
+ unsigned long int *spans;
+ size_t *rows;
+ unsigned long int width;
+ unsigned long int height;
+ unsigned long int used;
 };
 
 class Text
@@ -652,8 +1104,34 @@ class Text
  unsigned long int current_x;
  unsigned long int current_y;
  Sprite *font;
- void increase_position();
+ Frame *surface;
+ Glyph glyphs[128];
+ unsigned short int *glyph_pixels;
+ unsigned short int *glyph_spans;
+ unsigned long int glyph_width;
+ unsigned long int glyph_height;
+ unsigned long int font_revision;
+ bool font_transparent;
+ bool proportional;
+ Text_Cache *cache;
+ unsigned long int cache_size;
+ unsigned long int clock;
+ void increase_position(const char target);
  void restore_position();
+ void clear_glyphs();
+ unsigned long int count_spans(const bool *opaque,unsigned long int &pixels) const;
+ void create_glyphs();
+ void prepare_glyphs();
+ bool check_character(const char target) const;
+ unsigned long int get_advance(const char target) const;
+ void draw_glyph(const Glyph &target,const unsigned long int x,const unsigned long int y);
+ void clear_entry(Text_Cache &target);
+ void clear_cache();
+ Text_Cache *find_entry(const char *text);
+ Text_Cache *get_free_entry();
+ void render_entry(Text_Cache &target,const char *text);
+ void draw_entry(const Text_Cache &target);
+ void draw_cached_text(const char *text);
  public:
  Text();
  ~Text();
@@ -663,6 +1141,12 @@ class Text
  void draw_text(const char *text);
  void draw_character(const unsigned long int x,const unsigned long int y,const char target);
  void draw_text(const unsigned long int x,const unsigned long int y,const char *text);
+ void set_cache_size(const unsigned long int amount);
+ unsigned long int get_cache_size() const;
+ void flush_cache();
+ void set_proportional(const bool enabled);
+ bool get_proportional() const;
+ unsigned long int get_text_width(const char *text);
 };
 
 class Collision
@@ -683,4 +1167,289 @@ class Collision
  Collision_Box generate_box(const unsigned long int x,const unsigned long int y,const unsigned long int width,const unsigned long int height) const;
 };
 
+class Streamed_Background
+{
+ private:
+ Frame *surface;
+ Input_File target;
+ Chunk_head head;
+ Chunk_Slot *slots;
+ IMG_Pixel *chunk_buffer;
+ unsigned long int slot_amount;
+ unsigned long int columns;
+ unsigned long int rows;
+ unsigned long int margin;
+ unsigned long int clock;
+ unsigned long int sequence;
+ long int camera_x;
+ long int camera_y;
+ pthread_t loader;
+ pthread_mutex_t lock;
+ pthread_cond_t signal;
+ bool running;
+ void check_head();
+ void create_slots(const unsigned long int amount);
+ void start_loader();
+ void read_chunk(const unsigned long int chunk,unsigned short int *pixels);
+ bool check_visible(const unsigned long int chunk,const Collision_Box &view) const;
+ Collision_Box get_view(const unsigned long int extra) const;
+ void request_chunk(const unsigned long int chunk,const Collision_Box &view);
+ void request_range(const Collision_Box &range,const Collision_Box &view);
+ void draw_chunk(const Chunk_Slot &slot);
+ public:
+ Streamed_Background();
+ ~Streamed_Background();
+ void initialize(Frame *screen);
+ void create_chunk_file(const char *name,Image &source,const unsigned long int chunk_width,const unsigned long int chunk_height);
+ void open_world(const char *name,const unsigned long int cache_size);
+ void close_world();
+ void set_margin(const unsigned long int amount);
+ void set_camera(const long int x,const long int y);
+ long int get_camera_x() const;
+ long int get_camera_y() const;
+ unsigned long int get_world_width() const;
+ unsigned long int get_world_height() const;
+ unsigned long int get_resident();
+ void draw_world();
+ void load_chunks();
+};
+
+struct Parallax_Layer
+{
+ Background *background;
+ unsigned short int *pixels;
+ unsigned long int *spans;
+ size_t *rows;
+ unsigned long int width;
+ unsigned long int height;
+ unsigned long int frame;
+ size_t pixel_capacity;
+ size_t span_capacity;
+ size_t row_capacity;
+ float speed_x;
+ float speed_y;
+ bool transparent;
+};
+
+class Parallax_Background
+{
+ private:
+ Frame *surface;
+ Parallax_Layer *layers;
+ unsigned long int amount;
+ long int camera_x;
+ long int camera_y;
+ void clear_layer(Parallax_Layer &target);
+ size_t scan_spans(Parallax_Layer &target,const bool store);
+ void prepare_layer(Parallax_Layer &target);
+ void resize_layers();
+ size_t get_offset(const unsigned long int y,const unsigned long int width) const;
+ unsigned long int get_shift(const long int position,const float speed,const unsigned long int limit) const;
+ void draw_opaque_layer(const Parallax_Layer &target,const unsigned long int shift_x,const unsigned long int shift_y);
+ void draw_transparent_layer(const Parallax_Layer &target,const unsigned long int shift_x,const unsigned long int shift_y);
+ void draw_indexed_layer(const Parallax_Layer &target,const unsigned long int shift_x,const unsigned long int shift_y);
+ public:
+ Parallax_Background();
+ ~Parallax_Background();
+ void initialize(Frame *target);
+ void add_layer(Background *target,const float speed_x,const float speed_y,const bool transparent);
+ unsigned long int get_layer_amount() const;
+ void set_camera(const long int x,const long int y);
+ long int get_camera_x() const;
+ long int get_camera_y() const;
+ void draw_parallax();
+};
+
+class Scene
+{
+ private:
+ Sprite **sprites;
+ unsigned long int amount;
+ unsigned long int used;
+ void resize_scene();
+ public:
+ Scene();
+ ~Scene();
+ void add_sprite(Sprite *target);
+ void remove_sprite(Sprite *target);
+ unsigned long int get_amount() const;
+ void erase();
+ void draw();
+};
+
+struct Display_Node
+{
+ NODE_TYPE kind;
+ Sprite *sprite;
+ Tileset *tileset;
+ Background *background;
+ unsigned long int layer;
+ unsigned long int row;
+ unsigned long int column;
+ unsigned long int x;
+ unsigned long int y;
+ bool visible;
+ bool opaque;
+ bool active;
+ bool drawable;
+ bool drawn;
+ unsigned long int frame;
+ unsigned long int state;
+ unsigned long int previous_frame;
+ unsigned long int previous_state;
+ Collision_Box box;
+ Collision_Box previous;
+};
+
+class Display_List
+{
+ private:
+ Frame *surface;
+ Display_Node *nodes;
+ unsigned long int *order;
+ unsigned long int amount;
+ unsigned long int ordered;
+ Collision_Box dirty;
+ bool dirty_used;
+ bool full;
+ void resize_list();
+ unsigned long int get_free_node();
+ Collision_Box get_screen_box() const;
+ Collision_Box clip_box(const Collision_Box &target) const;
+ bool check_overlap(const Collision_Box &first,const Collision_Box &second) const;
+ bool check_inside(const Collision_Box &inner,const Collision_Box &outer) const;
+ void merge_dirty(const Collision_Box &target);
+ void sort_nodes();
+ void prepare_node(Display_Node &node);
+ bool check_change(const Display_Node &node) const;
+ void find_occlusion();
+ void find_dirty();
+ void expand_dirty();
+ void draw_base();
+ void draw_node(const Display_Node &node);
+ void store_state();
+ public:
+ Display_List();
+ ~Display_List();
+ void initialize(Frame *target);
+ unsigned long int add_sprite(Sprite *target,const unsigned long int layer);
+ unsigned long int add_tile(Tileset *target,const unsigned long int row,const unsigned long int column,const unsigned long int x,const unsigned long int y,const unsigned long int layer);
+ unsigned long int add_background(Background *target,const unsigned long int layer);
+ void remove_node(const unsigned long int index);
+ void set_layer(const unsigned long int index,const unsigned long int layer);
+ void set_visible(const unsigned long int index,const bool enabled);
+ void set_tile_position(const unsigned long int index,const unsigned long int x,const unsigned long int y);
+ bool get_visible(const unsigned long int index) const;
+ bool is_drawn(const unsigned long int index) const;
+ unsigned long int get_amount() const;
+ void invalidate();
+ void draw();
+};
+
+class Asset_Pack
+{
+ private:
+ int target;
+ unsigned char *data;
+ size_t length;
+ const Pack_Entry *entries;
+ unsigned long int amount;
+ void check_pack();
+ void check_entry(const Pack_Entry &entry) const;
+ public:
+ Asset_Pack();
+ ~Asset_Pack();
+ void open(const char *name);
+ void close();
+ unsigned long int get_amount() const;
+ bool check_asset(const char *name) const;
+ const Pack_Entry *get_asset(const unsigned long int index) const;
+ const Pack_Entry *get_asset(const char *name) const;
+ unsigned short int *get_pixels(const Pack_Entry *asset);
+};
+
+class Asset_Packer
+{
+ private:
+ Output_File output;
+ Pack_head head;
+ Pack_Entry *entries;
+ unsigned long int capacity;
+ void resize_index();
+ void write_pixels(Image &source);
+ void add_asset(const char *name,Image &source,const ASSET_TYPE kind,const unsigned long int frames,const unsigned long int setting,const unsigned long int rows,const unsigned long int columns);
+ public:
+ Asset_Packer();
+ ~Asset_Packer();
+ void create_pack(const char *name);
+ void add_image(const char *name,Image &source);
+ void add_sprite(const char *name,Image &source,const SPRITE_TYPE kind,const unsigned long int frames);
+ void add_background(const char *name,Image &source,const BACKGROUND_TYPE kind,const unsigned long int frames);
+ void add_tileset(const char *name,Image &source,const unsigned long int row_amount,const unsigned long int column_amount);
+ void finish_pack();
+ unsigned long int get_amount() const;
+};
+
+struct Load_Job
+{
+ char *name;
+ Surface *surface;
+ Audio *audio;
+ LOAD_TYPE kind;
+ LOAD_STATE state;
+ unsigned long int width;
+ unsigned long int height;
+ unsigned long int order;
+ unsigned long int time;
+ bool notified;
+};
+
+class Async_Loader
+{
+ private:
+ Load_Job *jobs;
+ unsigned long int amount;
+ unsigned long int sequence;
+ LOAD_CALLBACK callback;
+ void *callback_data;
+ pthread_t *loaders;
+ unsigned long int workers;
+ pthread_mutex_t lock;
+ pthread_cond_t signal;
+ pthread_cond_t finished;
+ bool running;
+ void start_loader();
+ void resize_jobs();
+ unsigned long int get_free_job();
+ unsigned long int add_job(const char *name,const LOAD_TYPE kind,const unsigned long int width,const unsigned long int height);
+ void clear_job(Load_Job &job);
+ void check_index(const unsigned long int index) const;
+ unsigned long int count_pending() const;
+ unsigned long int get_clock() const;
+ void wait_job(const unsigned long int index);
+ public:
+ Async_Loader();
+ ~Async_Loader();
+ void set_callback(LOAD_CALLBACK target,void *data);
+ void set_workers(const unsigned long int amount);
+ unsigned long int get_workers() const;
+ unsigned long int load_tga(const char *name);
+ unsigned long int load_pcx(const char *name);
+ unsigned long int load_tga(const char *name,const unsigned long int target_width,const unsigned long int target_height);
+ unsigned long int load_pcx(const char *name,const unsigned long int target_width,const unsigned long int target_height);
+ unsigned long int load_wave(const char *name);
+ void load_batch(const Load_Item *items,const unsigned long int item_amount,unsigned long int *indexes);
+ LOAD_STATE get_state(const unsigned long int index);
+ bool is_ready(const unsigned long int index);
+ unsigned long int get_pending();
+ unsigned long int get_load_time(const unsigned long int index);
+ void print_report();
+ void update();
+ void wait_all();
+ void take_surface(const unsigned long int index,Surface &target);
+ void take_audio(const unsigned long int index,Audio &target);
+ void cancel(const unsigned long int index);
+ void load_jobs();
+};
+
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "gophergdk.h"
+
+void load_source(GOPHERGDK::Image &image,const char *name)
+{
+ size_t length;
+ length=strlen(name);
+ if (length>4)
+ {
+  if (strcmp(name+length-4,".pcx")==0)
+  {
+   image.load_pcx(name);
+   return;
+  }
+
+ }
+ image.load_tga(name);
+}
+
+SPRITE_TYPE get_sprite_kind(const char *name)
+{
+ SPRITE_TYPE kind;
+ kind=SINGLE_SPRITE;
+ if (strcmp(name,"horizontal")==0) kind=HORIZONTAL_STRIP;
+ if (strcmp(name,"vertical")==0) kind=VERTICAL_STRIP;
+ return kind;
+}
+
+bool check_setting(const char *name,const char *first)
+{
+ return (strcmp(name,first)==0)||(strcmp(name,"horizontal")==0)||(strcmp(name,"vertical")==0);
+}
+
+BACKGROUND_TYPE get_background_kind(const char *name)
+{
+ BACKGROUND_TYPE kind;
+ kind=NORMAL_BACKGROUND;
+ if (strcmp(name,"horizontal")==0) kind=HORIZONTAL_BACKGROUND;
+ if (strcmp(name,"vertical")==0) kind=VERTICAL_BACKGROUND;
+ return kind;
+}
+
+int stop_packing(FILE *list,const char *pack,const char *name,const char *message)
+{
+ printf("%s: %s\n",name,message);
+ fclose(list);
+ remove(pack);
+ return 1;
+}
+
+int main(int argc,char *argv[])
+{
+ FILE *list;
+ char kind[16];
+ char name[32];
+ char file[256];
+ char setting[16];
+ int result;
+ unsigned long int first,second;
+ GOPHERGDK::Image image;
+ GOPHERGDK::Asset_Packer packer;
+ if (argc!=3)
+ {
+  puts("Usage: packer <asset pack> <asset list>");
+  return 0;
+ }
+ list=fopen(argv[2],"r");
+ if (list==NULL)
+ {
+  puts("Can't open the asset list");
+  return 1;
+ }
+ packer.create_pack(argv[1]);
+ result=fscanf(list,"%15s %31s %255s",kind,name,file);
+ while (result==3)
+ {
+  if (strcmp(kind,"sprite")==0)
+  {
+   if (fscanf(list,"%15s %lu",setting,&first)!=2) return stop_packing(list,argv[1],name,"Invalid sprite settings");
+   if (check_setting(setting,"single")==false) return stop_packing(list,argv[1],name,"Unknown sprite type");
+   load_source(image,file);
+   packer.add_sprite(name,image,get_sprite_kind(setting),first);
+  }
+  else if (strcmp(kind,"background")==0)
+  {
+   if (fscanf(list,"%15s %lu",setting,&first)!=2) return stop_packing(list,argv[1],name,"Invalid background settings");
+   if (check_setting(setting,"normal")==false) return stop_packing(list,argv[1],name,"Unknown background type");
+   load_source(image,file);
+   packer.add_background(name,image,get_background_kind(setting),first);
+  }
+  else if (strcmp(kind,"tileset")==0)
+  {
+   if (fscanf(list,"%lu %lu",&first,&second)!=2) return stop_packing(list,argv[1],name,"Invalid tileset settings");
+   load_source(image,file);
+   packer.add_tileset(name,image,first,second);
+  }
+  else if (strcmp(kind,"image")==0)
+  {
+   load_source(image,file);
+   packer.add_image(name,image);
+  }
+  else
+  {
+   return stop_packing(list,argv[1],name,"Unknown asset kind");
+  }
+  printf("%s: %lux%lu\n",name,image.get_width(),image.get_height());
+  result=fscanf(list,"%15s %31s %255s",kind,name,file);
+ }
+ if (result!=EOF) return stop_packing(list,argv[1],argv[2],"Incomplete asset description");
+ fclose(list);
+ packer.finish_pack();
+ printf("Packed %lu assets\n",packer.get_amount());
+ return 0;
+}
\ No newline at end of file